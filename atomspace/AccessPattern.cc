@@ -0,0 +1,159 @@
+/** AccessPattern.cc */
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <sstream>
+
+#include "AccessPattern.h"
+
+namespace opencog {
+
+// A prime; multiplying by it modulo n is a permutation of [0, n) for
+// any n it does not divide, which scatters the popular indexes.
+static const unsigned long long SCATTER = 2654435761ULL;
+
+AccessPattern::AccessPattern()
+    : _kind(UNIFORM), _exponent(0.99), _hotOps(0.9), _hotAtoms(0.1),
+      _seq(0), _n(0), _hX1(0.0), _hN(0.0), _sv(0.0)
+{
+}
+
+bool AccessPattern::parse(const std::string& spec)
+{
+    std::string name = spec.substr(0, spec.find(':'));
+    std::string args = (spec.find(':') == std::string::npos) ?
+                       "" : spec.substr(spec.find(':') + 1);
+    _n = 0;
+    _seq = 0;
+
+    if (name == "uniform" and args.empty())
+        _kind = UNIFORM;
+    else if (name == "sequential" and args.empty())
+        _kind = SEQUENTIAL;
+    else if (name == "zipf" or name == "latest")
+    {
+        _kind = (name == "zipf") ? ZIPF : LATEST;
+        _exponent = args.empty() ? 0.99 : atof(args.c_str());
+        if (_exponent <= 0.0) return false;
+    }
+    else if (name == "hotspot")
+    {
+        _kind = HOTSPOT;
+        double x, y;
+        if (2 != sscanf(args.c_str(), "%lf:%lf", &x, &y)) return false;
+        if (x < 0.0 or 100.0 < x or y <= 0.0 or 100.0 < y) return false;
+        _hotOps = x / 100.0;
+        _hotAtoms = y / 100.0;
+    }
+    else return false;
+    return true;
+}
+
+std::string AccessPattern::describe() const
+{
+    std::ostringstream oss;
+    switch (_kind)
+    {
+    case UNIFORM: return "uniform";
+    case SEQUENTIAL: return "sequential";
+    case ZIPF: oss << "zipf, exponent " << _exponent; break;
+    case LATEST: oss << "latest, zipf exponent " << _exponent; break;
+    case HOTSPOT:
+        oss << "hotspot, " << 100.0 * _hotOps << "% of reads on "
+            << 100.0 * _hotAtoms << "% of atoms";
+        break;
+    }
+    return oss.str();
+}
+
+size_t AccessPattern::next(MT19937RandGen& rng, size_t n)
+{
+    if (n <= 1) return 0;
+    switch (_kind)
+    {
+    case UNIFORM:
+        return (size_t) (rng.randdouble() * n) % n;
+    case SEQUENTIAL:
+        return _seq++ % n;
+    case LATEST:
+        return n - zipf(rng, n);
+    case ZIPF:
+        return ((zipf(rng, n) - 1) * SCATTER) % n;
+    case HOTSPOT: {
+        size_t hot = std::max((size_t) 1, (size_t) (_hotAtoms * n));
+        size_t i;
+        if (hot == n or rng.randdouble() < _hotOps)
+            i = (size_t) (rng.randdouble() * hot) % hot;
+        else
+            i = hot + (size_t) (rng.randdouble() * (n - hot)) % (n - hot);
+        return (i * SCATTER) % n;
+    }
+    }
+    return 0;
+}
+
+// ================================================================
+// Zipf sampling by rejection-inversion. h(x) = x^-s is the (unnormalized)
+// density; hIntegral is its integral, arranged to be accurate for s
+// near one. See W. Hörmann and G. Derflinger, "Rejection-inversion to
+// generate variates from monotone discrete distributions", ACM TOMACS
+// 6 (1996).
+
+// log(1+x)/x, and (exp(x)-1)/x, without the loss of precision near 0.
+static double helper1(double x)
+{
+    if (1e-8 < fabs(x)) return log1p(x) / x;
+    return 1.0 - x * (0.5 - x * (1.0/3.0 - 0.25 * x));
+}
+
+static double helper2(double x)
+{
+    if (1e-8 < fabs(x)) return expm1(x) / x;
+    return 1.0 + x * 0.5 * (1.0 + x / 3.0 * (1.0 + 0.25 * x));
+}
+
+double AccessPattern::h(double x) const
+{
+    return exp(-_exponent * log(x));
+}
+
+double AccessPattern::hIntegral(double x) const
+{
+    double logX = log(x);
+    return helper2((1.0 - _exponent) * logX) * logX;
+}
+
+double AccessPattern::hIntegralInverse(double x) const
+{
+    double t = x * (1.0 - _exponent);
+    if (t < -1.0) t = -1.0;
+    return exp(helper1(t) * x);
+}
+
+void AccessPattern::setup(size_t n)
+{
+    _n = n;
+    _hX1 = hIntegral(1.5) - 1.0;
+    _hN = hIntegral(n + 0.5);
+    _sv = 2.0 - hIntegralInverse(hIntegral(2.5) - h(2.0));
+}
+
+// A value in 1..n, with 1 the most likely.
+size_t AccessPattern::zipf(MT19937RandGen& rng, size_t n)
+{
+    if (n != _n) setup(n);
+    while (true)
+    {
+        double u = _hN + rng.randdouble() * (_hX1 - _hN);
+        double x = hIntegralInverse(u);
+        double k = floor(x + 0.5);
+        if (k < 1.0) k = 1.0;
+        else if (n < k) k = n;
+        if (k - x <= _sv or hIntegral(k + 0.5) - h(k) <= u)
+            return (size_t) k;
+    }
+}
+
+} // namespace opencog
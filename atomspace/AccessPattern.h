@@ -0,0 +1,64 @@
+#ifndef _OPENCOG_ACCESS_PATTERN_H
+#define _OPENCOG_ACCESS_PATTERN_H
+
+#include <cstddef>
+#include <string>
+
+#include <opencog/util/mt19937ar.h>
+
+namespace opencog
+{
+
+/**
+ * Which atoms the read benchmarks touch. By default every atom is
+ * equally likely, so every read hits a cold cache; real workloads are
+ * skewed. The patterns are:
+ *
+ *   uniform             every atom equally likely
+ *   zipf:<s>            the k-th most popular atom is read with
+ *                       probability proportional to 1/k^s
+ *   hotspot:<x>:<y>     x percent of the reads go to y percent of the atoms
+ *   sequential          in insertion order, wrapping around
+ *   latest:<s>          zipf over recency: the newest atoms are hottest
+ *
+ * For zipf and hotspot, the popular atoms are scattered over the
+ * insertion order, so that they are not also neighbours in memory.
+ */
+class AccessPattern
+{
+public:
+    enum Kind { UNIFORM, ZIPF, HOTSPOT, SEQUENTIAL, LATEST };
+
+    AccessPattern();
+
+    /// Set the pattern from a spec as above; false if it is malformed.
+    bool parse(const std::string& spec);
+    std::string describe() const;
+    Kind kind() const { return _kind; }
+
+    /// Index, in [0, n), of the next atom to read.
+    size_t next(MT19937RandGen&, size_t n);
+
+private:
+    Kind _kind;
+    double _exponent;
+    double _hotOps;
+    double _hotAtoms;
+    size_t _seq;
+
+    // Rejection-inversion sampler for zipf over 1..n, after Hörmann
+    // and Derflinger (1996); set up in O(1) whenever n changes.
+    size_t _n;
+    double _hX1;
+    double _hN;
+    double _sv;
+    void setup(size_t n);
+    double h(double x) const;
+    double hIntegral(double x) const;
+    double hIntegralInverse(double x) const;
+    size_t zipf(MT19937RandGen&, size_t n);
+};
+
+} // namespace opencog
+
+#endif // _OPENCOG_ACCESS_PATTERN_H
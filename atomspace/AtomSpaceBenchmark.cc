@@ -1,11 +1,21 @@
 
 /** AtomSpaceBenchmark.cc */
 
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cerrno>
+#include <cmath>
 #include <ctime>
 #include <iostream>
 #include <fstream>
+#include <sstream>
+#include <thread>
+#include <malloc.h>
+#include <unistd.h>
 #include <sys/time.h>
 #include <sys/resource.h>
+#include <sys/wait.h>
 
 #include <boost/tuple/tuple_io.hpp>
 
@@ -19,6 +29,7 @@
 #include <opencog/atoms/truthvalue/IndefiniteTruthValue.h>
 #include <opencog/atoms/truthvalue/SimpleTruthValue.h>
 #include <opencog/atoms/truthvalue/TruthValue.h>
+#include <opencog/atoms/value/FloatValue.h>
 #include <opencog/atomspaceutils/TLB.h>
 #include <opencog/guile/SchemeEval.h>
 
@@ -27,6 +38,8 @@
 #endif
 
 #include "AtomSpaceBenchmark.h"
+#include "MachineProbes.h"
+#include "SampleRing.h"
 
 const char* VERSION_STRING = "Version 1.1.1";
 
@@ -46,6 +59,15 @@ using std::time;
 #define GUILE_SYMB "foo"
 #define GUILE_FUNB "fnu"
 
+// Run one operation of a timed loop. With -H, each operation is also
+// timed on its own, into the preallocated latency histogram.
+#define TIMED_OP(...) {                                     \
+    if (latencyHist) {                                      \
+        uint64_t op_begin = monotonic_ns();                 \
+        __VA_ARGS__;                                        \
+        latencyHist->record(monotonic_ns() - op_begin);     \
+    } else { __VA_ARGS__; } }
+
 TLB tlbuf;
 
 AtomSpaceBenchmark::AtomSpaceBenchmark()
@@ -79,6 +101,42 @@ AtomSpaceBenchmark::AtomSpaceBenchmark()
     chanceUseDefaultTV = 0.8f;
     doStats = false;
     testKind = BENCH_AS;
+    nThreads = 1;
+    perOpLatency = false;
+    latencyHist = NULL;
+    hwCounters = false;
+    perfCounters = NULL;
+    profiler = NULL;
+    profileHz = 997;
+    isolation = ISOLATE_NONE;
+    failedRuns = 0;
+    recorder = NULL;
+    leaves = NULL;
+    lookupHitRatio = 0.5;
+    scanThreads = std::max(1u, std::thread::hardware_concurrency());
+    scanAtoms = 0;
+    scanTicks = 0;
+    lookupGroups.assign(2, LookupGroup());
+    rmTreeDepth = 4;
+    rmTreeFanout = 2;
+    workerIndex = 0;
+    subtractOverhead = true;
+    runProbes = true;
+    overheadCalibrated = false;
+    overheadPerRegion = 0.0;
+    overheadPerOp = 0.0;
+    repetitions = 0;
+    compareAlpha = 0.05;
+    memAccounting = false;
+    openLoopSeconds = 1.0;
+    autoCalibrate = false;
+    buildThreads = 1;
+    buildScaling = false;
+    autoCI = 0.01;
+    autoMaxSeconds = 60.0;
+    nodeIndexBytes = 0.0;
+    linkIndexBytes = 0.0;
+    incomingEntryBytes = 0.0;
 
     randomseed = (unsigned long) time(NULL);
 
@@ -91,11 +149,13 @@ AtomSpaceBenchmark::~AtomSpaceBenchmark()
 {
     delete poissonDistribution;
     delete randomGenerator;
+    delete latencyHist;
+    delete perfCounters;
 }
 
-// This is wrong, because it fails to count also the amount of RAM
-// used by the AtomTable to store indexes.
-size_t AtomSpaceBenchmark::estimateOfAtomSize(Handle h)
+// The index overhead is only known after measureAtomSizes() has run;
+// before that, only the C++ objects themselves are counted.
+size_t AtomSpaceBenchmark::estimateOfAtomSize(Handle h, bool recursive)
 {
     size_t total = 0;
     if (h->getTruthValue() != TruthValue::DEFAULT_TV())
@@ -114,14 +174,18 @@ size_t AtomSpaceBenchmark::estimateOfAtomSize(Handle h)
     NodePtr n(NodeCast(h));
     if (n)
     {
-        total = sizeof(Node);
+        total += sizeof(Node);
         total += n->get_name().capacity();
+        total += nodeIndexBytes;
     }
     else
     {
         LinkPtr l(LinkCast(h));
-        total = sizeof(Link);
+        total += sizeof(Link);
         total += l->getOutgoingSet().capacity() * sizeof(Handle);
+        total += linkIndexBytes
+               + l->getOutgoingSet().size() * incomingEntryBytes;
+        if (not recursive) return total;
         for (Handle ho: l->getOutgoingSet())
         {
             total += estimateOfAtomSize(ho);
@@ -131,15 +195,136 @@ size_t AtomSpaceBenchmark::estimateOfAtomSize(Handle h)
     return total;
 }
 
+// Bytes currently handed out by malloc (and so by operator new), as
+// counted by the allocator itself. Memory of the guile and python
+// garbage collectors is not included.
+static size_t liveHeapBytes()
+{
+#if defined(__GLIBC__) && __GLIBC_PREREQ(2,33)
+    struct mallinfo2 mi = mallinfo2();
+#else
+    struct mallinfo mi = mallinfo();
+#endif
+    return (size_t) mi.uordblks + (size_t) mi.hblkhd;
+}
+
 long AtomSpaceBenchmark::getMemUsage()
 {
-    // getrusage is the best option it seems...
-    // on linux /proc/pid/status and other files may have more detail
-    struct rusage *s = (struct rusage *) malloc(sizeof(struct rusage));
-    getrusage(RUSAGE_SELF,s);
-    long rss = s->ru_maxrss;
-    free(s);
-    return rss;
+    // The max RSS from getrusage() never goes down, so freed memory
+    // was invisible. The live heap size does go down.
+    return liveHeapBytes() / 1024;
+}
+
+// Measure how many heap bytes atoms take: first as free-standing C++
+// objects, then again once added to an atomspace. The difference is
+// the cost of the AtomTable indexes: one type-index entry per atom,
+// plus one incoming-set entry per outgoing atom of each link. The
+// latter two are split apart with a least-squares fit over the arity.
+void AtomSpaceBenchmark::measureAtomSizes()
+{
+    const size_t N = 1 << 16;
+    const Arity MAX_ARITY = 4;
+
+    cout << "==Live heap bytes per atom (" << N << " of each)==" << endl;
+    printf("%-22s %10s %10s %10s\n", "", "object", "index", "total");
+
+    AtomSpace scratch;
+    HandleSeq nodes;
+    nodes.reserve(N);
+    size_t before = liveHeapBytes();
+    for (size_t i = 0; i < N; i++)
+        nodes.push_back(createNode(CONCEPT_NODE, "node " + std::to_string(i)));
+    double object = (double) (liveHeapBytes() - before) / N;
+
+    before = liveHeapBytes();
+    for (const Handle& h : nodes)
+        scratch.add_atom(h);
+    nodeIndexBytes = (double) (liveHeapBytes() - before) / N;
+    printf("%-22s %10.1f %10.1f %10.1f\n", "ConceptNode",
+           object, nodeIndexBytes, object + nodeIndexBytes);
+
+    double sk = 0, sk2 = 0, sx = 0, skx = 0;
+    for (Arity k = 1; k <= MAX_ARITY; k++)
+    {
+        std::vector<HandleSeq> osets(N);
+        for (size_t i = 0; i < N; i++)
+            for (Arity j = 0; j < k; j++)
+                osets[i].push_back(nodes[(i + j * 7919) % N]);
+
+        HandleSeq links;
+        links.reserve(N);
+        before = liveHeapBytes();
+        for (size_t i = 0; i < N; i++)
+            links.push_back(createLink(std::move(osets[i]), LIST_LINK));
+        object = (double) (liveHeapBytes() - before) / N;
+
+        before = liveHeapBytes();
+        for (const Handle& h : links)
+            scratch.add_atom(h);
+        double index = (double) (liveHeapBytes() - before) / N;
+
+        std::string label = "ListLink arity " + std::to_string(k);
+        printf("%-22s %10.1f %10.1f %10.1f\n", label.c_str(),
+               object, index, object + index);
+
+        sk += k; sk2 += k*k; sx += index; skx += k*index;
+    }
+    incomingEntryBytes = (MAX_ARITY*skx - sk*sx) / (MAX_ARITY*sk2 - sk*sk);
+    linkIndexBytes = (sx - incomingEntryBytes*sk) / MAX_ARITY;
+
+    printf("Type index entry: %.1f bytes per node, %.1f per link\n",
+           nodeIndexBytes, linkIndexBytes);
+    printf("Incoming set entry: %.1f bytes per outgoing atom\n",
+           incomingEntryBytes);
+    cout << DIVIDER_LINE << endl;
+}
+
+// Break down the atoms in the test atomspace by type. The bytes are
+// from estimateOfAtomSize(), i.e. object sizes plus the index costs
+// measured by measureAtomSizes(); the total is compared against what
+// the live heap actually grew by while building.
+void AtomSpaceBenchmark::printTypeBreakdown(size_t heapBytes)
+{
+    size_t totalAtoms = 0;
+    double totalBytes = 0.0;
+    struct Row { Type t; size_t count; double arity; double bytes; };
+    std::vector<Row> rows;
+    for (Type t = ATOM; t < numberOfTypes; t++)
+    {
+        HandleSeq hs;
+        if (testKind == BENCH_TABLE)
+            atab->getHandlesByType(back_inserter(hs), t, false);
+        else
+            asp->get_handles_by_type(back_inserter(hs), t, false);
+        if (hs.empty()) continue;
+
+        Row row = { t, hs.size(), 0.0, 0.0 };
+        for (const Handle& h : hs)
+        {
+            if (h->is_link()) row.arity += h->get_arity();
+            row.bytes += estimateOfAtomSize(h, false);
+        }
+        row.arity /= row.count;
+        rows.push_back(row);
+        totalAtoms += row.count;
+        totalBytes += row.bytes;
+    }
+    std::sort(rows.begin(), rows.end(),
+              [](const Row& a, const Row& b) { return a.bytes > b.bytes; });
+
+    printf("Built atomspace: %zu atoms, live heap grew by %zu bytes "
+           "(%.1f per atom)\n", totalAtoms, heapBytes,
+           totalAtoms ? (double) heapBytes / totalAtoms : 0.0);
+    printf("%-28s %10s %7s %14s %10s %6s\n", "type", "count", "arity",
+           "est. bytes", "per atom", "%");
+    for (const Row& row : rows)
+        printf("%-28s %10zu %7.2f %14.0f %10.1f %6.2f\n",
+               nameserver().getTypeName(row.t).c_str(), row.count,
+               row.arity, row.bytes, row.bytes / row.count,
+               100.0 * row.bytes / totalBytes);
+    printf("Estimated total: %.0f bytes; not accounted for: %.0f bytes\n",
+           totalBytes, heapBytes - totalBytes);
+    cout << DIVIDER_LINE << endl;
 }
 
 void AtomSpaceBenchmark::printTypeSizes()
@@ -203,7 +388,15 @@ void AtomSpaceBenchmark::showMethods()
     cout << "  addNode" << endl;
     cout << "  addLink" << endl;
     cout << "  removeAtom" << endl;
+    cout << "  removeAtomRecursive" << endl;
     cout << "  getHandlesByType" << endl;
+    cout << "  scanType" << endl;
+    cout << "  scanSubclass" << endl;
+    cout << "  scanParallel (use --scan-threads to give the threads)" << endl;
+    cout << "  getNode" << endl;
+    cout << "  getLink" << endl;
+    cout << "  addNodeExisting" << endl;
+    cout << "  mix (use -W to give the operation mix)" << endl;
     cout << "  push_back" << endl;
     cout << "  emplace_back" << endl;
     cout << "  reserve" << endl;
@@ -286,12 +479,61 @@ void AtomSpaceBenchmark::setMethod(std::string methodToTest)
         foundMethod = true;
     }
 
+    if (methodToTest == "all" or methodToTest == "removeAtomRecursive") {
+        methodsToTest.push_back( &AtomSpaceBenchmark::bm_rmAtomRecursive);
+        methodNames.push_back("removeAtomRecursive");
+        foundMethod = true;
+    }
+
     if (methodToTest == "all" or methodToTest == "getHandlesByType") {
         methodsToTest.push_back( &AtomSpaceBenchmark::bm_getHandlesByType);
         methodNames.push_back("getHandlesByType");
         foundMethod = true;
     }
 
+    if (methodToTest == "all" or methodToTest == "scanType") {
+        methodsToTest.push_back( &AtomSpaceBenchmark::bm_scanType);
+        methodNames.push_back("scanType");
+        foundMethod = true;
+    }
+
+    if (methodToTest == "all" or methodToTest == "scanSubclass") {
+        methodsToTest.push_back( &AtomSpaceBenchmark::bm_scanSubclass);
+        methodNames.push_back("scanSubclass");
+        foundMethod = true;
+    }
+
+    if (methodToTest == "all" or methodToTest == "scanParallel") {
+        methodsToTest.push_back( &AtomSpaceBenchmark::bm_scanParallel);
+        methodNames.push_back("scanParallel");
+        foundMethod = true;
+    }
+
+    if (methodToTest == "all" or methodToTest == "getNode") {
+        methodsToTest.push_back( &AtomSpaceBenchmark::bm_getNode);
+        methodNames.push_back("getNode");
+        foundMethod = true;
+    }
+
+    if (methodToTest == "all" or methodToTest == "getLink") {
+        methodsToTest.push_back( &AtomSpaceBenchmark::bm_getLink);
+        methodNames.push_back("getLink");
+        foundMethod = true;
+    }
+
+    if (methodToTest == "all" or methodToTest == "addNodeExisting") {
+        methodsToTest.push_back( &AtomSpaceBenchmark::bm_addNodeExisting);
+        methodNames.push_back("addNodeExisting");
+        foundMethod = true;
+    }
+
+    // Not part of "all": it needs an operation mix, see setMix().
+    if (methodToTest == "mix") {
+        methodsToTest.push_back( &AtomSpaceBenchmark::bm_mix);
+        methodNames.push_back("mix");
+        foundMethod = true;
+    }
+
     if (methodToTest == "all" or methodToTest == "push_back") {
         methodsToTest.push_back( &AtomSpaceBenchmark::bm_push_back);
         methodNames.push_back("push_back");
@@ -329,9 +571,35 @@ void AtomSpaceBenchmark::setMethod(std::string methodToTest)
 
 }
 
+clock_t AtomSpaceBenchmark::timerStart()
+{
+    if (perfCounters) perfCounters->start();
+    if (profiler) SampleProfiler::resume();
+    return readClock();
+}
+
+clock_t AtomSpaceBenchmark::timerStop(clock_t t_begin)
+{
+    clock_t t_end = readClock();
+    if (profiler) SampleProfiler::pause();
+    if (perfCounters) perfCounters->stop();
+    return t_end - t_begin;
+}
+
+clock_t AtomSpaceBenchmark::readClock()
+{
+    // One thread: its CPU time, as clock() gave before; but not that
+    // of the -f sample writer or other helper threads. More: wall-clock
+    // time. Both in the same units as clock().
+    struct timespec ts;
+    clock_gettime(1 == nThreads ? CLOCK_THREAD_CPUTIME_ID : CLOCK_MONOTONIC,
+                  &ts);
+    return ts.tv_sec * CLOCKS_PER_SEC
+         + ts.tv_nsec / (1000000000 / CLOCKS_PER_SEC);
+}
+
 #define CALL_MEMBER_FN(object,ptrToMember)  ((object).*(ptrToMember))
-void AtomSpaceBenchmark::doBenchmark(const std::string& methodName,
-                                     BMFn methodToCall)
+void AtomSpaceBenchmark::setRepCounts(BMFn methodToCall)
 {
     Nclock = baseNclock;
     Nloops = baseNloops;
@@ -361,6 +629,94 @@ void AtomSpaceBenchmark::doBenchmark(const std::string& methodName,
             Nreps = asz / (4*Nclock*Nloops/3);
     }
 
+    // Each removal builds a whole tree first; keep the number of atoms
+    // added and removed about the same as for the other methods.
+    if (methodToCall == &AtomSpaceBenchmark::bm_rmAtomRecursive)
+    {
+        Nreps /= removeTreeSize();
+        if (0 == Nreps) Nreps = 1;
+    }
+
+    // Same for the removals in an operation mix.
+    double rmShare = mixWeights.empty() ? 0.0 : mixWeights[MIX_REMOVE_ATOM];
+    if (methodToCall == &AtomSpaceBenchmark::bm_mix and 0.0 < rmShare)
+    {
+        size_t asz = (testKind == BENCH_TABLE ?
+                      atab->getSize() : asp->get_size());
+        double removals = rmShare * Nreps * Nclock;
+        if (asz < 4*removals/3)
+            Nreps = 3*asz / (4*rmShare*Nclock);
+        if (0 == Nreps) Nreps = 1;
+    }
+}
+
+std::string AtomSpaceBenchmark::apiName() const
+{
+    switch (testKind) {
+        case BENCH_AS: return "AtomSpace";
+        case BENCH_TABLE: return "AtomTable";
+#if HAVE_GUILE
+        case BENCH_SCM:
+            if (memoize) return "Scheme memoized";
+            if (compile) return "Scheme compiled";
+            return "Scheme interpreted";
+#endif /* HAVE_GUILE */
+#if HAVE_CYTHON
+        case BENCH_PYTHON: return "Python";
+#endif /* HAVE_CYTHON */
+    }
+    return "";
+}
+
+static void addLatency(BenchResult& res, const LatencyHistogram& hist)
+{
+    res.latency.count = hist.count();
+    res.latency.mean = hist.mean();
+    res.latency.p50 = hist.percentile(50.0);
+    res.latency.p90 = hist.percentile(90.0);
+    res.latency.p99 = hist.percentile(99.0);
+    res.latency.p999 = hist.percentile(99.9);
+    res.latency.max = hist.max();
+}
+
+static void addCounters(BenchResult& res, const PerfCounters& pc, double nops)
+{
+    for (int e = 0; e < PerfCounters::NUM_EVENTS; e++)
+    {
+        PerfCounters::Event ev = (PerfCounters::Event) e;
+        if (pc.has(ev)) res.counters[PerfCounters::name(ev)] = pc.value(ev) / nops;
+    }
+}
+
+BenchResult AtomSpaceBenchmark::doBenchmark(const std::string& methodName,
+                                            BMFn methodToCall)
+{
+    setRepCounts(methodToCall);
+    if (perOpLatency)
+    {
+        if (NULL == latencyHist) latencyHist = new LatencyHistogram();
+        latencyHist->reset();
+    }
+    if (hwCounters and NULL == perfCounters)
+    {
+        perfCounters = new PerfCounters();
+        if (not perfCounters->available())
+        {
+            cout << "Hardware counters unavailable, continuing without: "
+                 << perfCounters->error() << endl;
+            delete perfCounters;
+            perfCounters = NULL;
+            hwCounters = false;
+        }
+    }
+    if (subtractOverhead and not overheadCalibrated) calibrateOverhead();
+    if (perfCounters) perfCounters->reset();
+    for (LatencyHistogram& hist : mixHist) hist.reset();
+    std::fill(mixCount.begin(), mixCount.end(), 0);
+    for (LookupGroup& g : lookupGroups) g.reset();
+    scanAtoms = 0;
+    scanTicks = 0;
+
     clock_t sumAsyncTime = 0;
     long rssStart;
     std::vector<record_t> records;
@@ -380,16 +736,28 @@ void AtomSpaceBenchmark::doBenchmark(const std::string& methodName,
 #endif /* HAVE_CYTHON */
     }
     cout << methodName << " method " << (Nclock*Nreps*Nloops) << " times ";
-    std::ofstream myfile;
-    if (saveToFile)
+    // Everything that -f and -k keep is allocated up front, so that
+    // neither shows up in the timings or in the heap numbers.
+    size_t nrecords = saveInterval ? Nreps / saveInterval : 0;
+    if (doStats) records.reserve(nrecords);
+    SampleRing* ring = NULL;
+    if (saveToFile and saveInterval)
     {
-        myfile.open ((methodName + "_benchmark.csv").c_str());
+        std::string fileName = methodName + "_benchmark.bin";
+        ring = new SampleRing(fileName, nrecords, CLOCKS_PER_SEC);
+        if (not ring->ok())
+        {
+            cerr << "Cannot save the records: " << ring->error() << endl;
+            delete ring;
+            ring = NULL;
+        }
     }
     int diff = (Nreps / PROGRESS_BAR_LENGTH);
     if (!diff) diff = 1;
     int counter = 0;
     rssStart = getMemUsage();
     long rssFromIncrease = 0;
+    size_t heapStart = liveHeapBytes();
     timeval tim;
     gettimeofday(&tim, NULL);
     double t1 = tim.tv_sec + (tim.tv_usec/1000000.0);
@@ -398,9 +766,15 @@ void AtomSpaceBenchmark::doBenchmark(const std::string& methodName,
         if (sizeIncrease)
         {
             long rssBeforeIncrease = getMemUsage();
+            UUID before = tlbuf.size();
             buildAtomSpace(sizeIncrease, percentLinks, false);
             // Try to negate the memory increase due to adding atoms
             rssFromIncrease += (getMemUsage() - rssBeforeIncrease);
+            // Of the atoms there, only those just added can be new
+            // leaves; they got the last UUIDs.
+            if (leaves and usesLeaves(methodToCall))
+                for (UUID u = before + 1; u <= tlbuf.size(); u++)
+                    leaves->offer(tlbuf.getAtom(u));
         }
         size_t atomspaceSize = (testKind == BENCH_TABLE ?
                                 atab->getSize() : asp->get_size());
@@ -410,15 +784,13 @@ void AtomSpaceBenchmark::doBenchmark(const std::string& methodName,
         if (saveInterval && counter % saveInterval == 0)
         {
             // Only save datapoints every saveInterval calls
-            record_t dataPoint(atomspaceSize,get<0>(timeTaken),getMemUsage()-rssStart-rssFromIncrease);
-            // Only save datapoints if we have to calculate the stats
-            // afterwards, otherwise it affects memory usage
+            long heapDelta = getMemUsage()-rssStart-rssFromIncrease;
             if (doStats) {
                 if (get<0>(timeTaken) < 0) cout << "ftumf" << endl;
-                records.push_back(dataPoint);
+                records.push_back(record_t(atomspaceSize,
+                                           get<0>(timeTaken), heapDelta));
             }
-            // otherwise, we might write directly to a file
-            if (saveToFile) recordToFile(myfile,dataPoint);
+            if (ring) ring->push(atomspaceSize, get<0>(timeTaken), heapDelta);
         }
         if (i % diff == 0) cerr << "." << flush;
     }
@@ -431,8 +803,26 @@ void AtomSpaceBenchmark::doBenchmark(const std::string& methodName,
     cout << "Sum clock() time for all requests: " << sumAsyncTime << " (" <<
         (float) sumAsyncTime / CLOCKS_PER_SEC << " seconds, "<<
         1.0f/(((float)sumAsyncTime/CLOCKS_PER_SEC) / (Nreps*Nclock*Nloops)) << " requests per second)" << endl;
-    //cout << "Memory (max RSS) change after benchmark: " <<
-    //    (rssEnd - rssStart - rssFromIncrease) / 1024 << "kb" << endl;
+
+    BenchResult res;
+    res.method = methodName;
+    res.api = apiName();
+    res.ops = Nreps*Nclock*Nloops;
+    res.wallSeconds = t2-t1;
+    res.opsPerSec = res.ops / ((double) sumAsyncTime / CLOCKS_PER_SEC);
+    if (subtractOverhead and methodToCall != &AtomSpaceBenchmark::bm_noop)
+        removeOverhead(res, sumAsyncTime, Nreps);
+    res.samples.push_back(res.opsPerSec);
+
+    if (memAccounting)
+    {
+        long delta = (long) liveHeapBytes() - (long) heapStart
+                   - 1024 * rssFromIncrease;
+        printf("Live heap change after benchmark: %+ld bytes "
+               "(%.1f per operation)\n",
+               delta, (double) delta / (Nreps*Nclock*Nloops));
+        res.extra["heap_delta_bytes"] = delta;
+    }
 
     if (saveInterval && doStats)
     {
@@ -441,21 +831,323 @@ void AtomSpaceBenchmark::doBenchmark(const std::string& methodName,
         AtomSpaceBenchmark::TimeStats t(records);
         t.print();
     }
+    if (latencyHist)
+    {
+        printLatency(*latencyHist);
+        addLatency(res, *latencyHist);
+    }
+    if (perfCounters)
+    {
+        printPerfCounters(*perfCounters, res.ops);
+        addCounters(res, *perfCounters, res.ops);
+    }
+    if (methodToCall == &AtomSpaceBenchmark::bm_mix) printMix(res);
+    printLookup(res);
+    printScan(res);
+    if (ring)
+    {
+        ring->close();
+        cout << "Saved " << ring->written() << " records to "
+             << methodName << "_benchmark.bin" << endl;
+        if (ring->dropped())
+            cout << "Warning: " << ring->dropped() << " records dropped, "
+                 << "the writer could not keep up" << endl;
+        if (not ring->error().empty())
+            cout << "Warning: cannot save the records: "
+                 << ring->error() << endl;
+        delete ring;
+    }
     cout << DIVIDER_LINE << endl;
-    if (saveToFile) { myfile.close(); }
+    return res;
+}
+
+// Smallest step of the benchmark clock, in clock ticks.
+clock_t AtomSpaceBenchmark::timerResolution()
+{
+    clock_t res = 0;
+    for (int i = 0; i < 5; i++)
+    {
+        clock_t t0 = readClock();
+        clock_t t1;
+        do { t1 = readClock(); } while (t1 == t0);
+        if (0 == res or t1 - t0 < res) res = t1 - t0;
+    }
+    return res;
+}
+
+// The timed region of bm_noop, without its random numbers, so that
+// calibrating does not change the random choices of the benchmark.
+clock_t AtomSpaceBenchmark::emptyRegion(unsigned int n)
+{
+    std::vector<int> v(n);
+    for (unsigned int i=0; i<n; i++) v[i] = i % 42;
+
+    clock_t t_begin = timerStart();
+    int sum=0;
+    for (unsigned int i=0; i<n; i++)
+        TIMED_OP(sum += v[i]);
+    clock_t time_taken = timerStop(t_begin);
+    global += sum;
+    return time_taken;
+}
+
+// Measure what a timed region costs when there is nothing in it: the
+// clock reads (and counters and latency timing, when those are on),
+// plus the loop around TIMED_OP for each operation. The clock ticks
+// far too coarsely to time one empty region, but summed over many of
+// them the rounding averages out. Fit cost = perRegion + perOp * n
+// through regions of 1 and of LOOP_OPS operations.
+void AtomSpaceBenchmark::calibrateOverhead()
+{
+    static const int REGIONS = 20000;
+    static const unsigned int LOOP_OPS = 4096;
+    static const int LOOPS = 200;
+
+    SampleProfiler* saveProfiler = profiler;
+    profiler = NULL;
+    double one = 0.0, many = 0.0;
+    for (int i = 0; i < REGIONS; i++) one += emptyRegion(1);
+    for (int i = 0; i < LOOPS; i++) many += emptyRegion(LOOP_OPS);
+    profiler = saveProfiler;
+    if (latencyHist) latencyHist->reset();
+    if (perfCounters) perfCounters->reset();
+
+    one /= REGIONS;
+    many /= LOOPS;
+    overheadPerOp = std::max(0.0, (many - one) / (LOOP_OPS - 1));
+    overheadPerRegion = std::max(0.0, one - overheadPerOp);
+    overheadCalibrated = true;
+
+    double ns = 1.0e9 / CLOCKS_PER_SEC;
+    printf("Timer overhead: %.1f ns per timed region, "
+           "plus %.2f ns per operation of loop\n",
+           overheadPerRegion * ns, overheadPerOp * ns);
+}
+
+// Overhead of one call of the current method, in clock ticks.
+double AtomSpaceBenchmark::regionOverhead() const
+{
+    return overheadPerRegion + overheadPerOp * Nclock;
+}
+
+// Measured ticks less the overhead; never less than one tick, so that
+// a region made of nothing but overhead does not divide by zero.
+double AtomSpaceBenchmark::netTicks(clock_t measured, double overhead) const
+{
+    return std::max((double) measured - overhead, 1.0);
+}
+
+// Take the overhead of `regions` timed regions out of the measured
+// time, and recompute the ops/sec. Also say how much of the wall time
+// was spent inside the timed regions at all; the rest is the setup in
+// the bm_* methods, such as picking random handles.
+void AtomSpaceBenchmark::removeOverhead(BenchResult& res, clock_t measured,
+                                        double regions)
+{
+    double overhead = regions * regionOverhead();
+    double secs = (double) measured / CLOCKS_PER_SEC;
+    res.extra["raw_ops_per_sec"] = res.opsPerSec;
+    res.extra["overhead_fraction"] = 0 < measured ? overhead / measured : 0.0;
+    res.extra["timed_fraction"] = 0.0 < res.wallSeconds ?
+                                  secs / res.wallSeconds : 0.0;
+    printf("Timed regions: %.1f%% of the wall time; timer and loop "
+           "overhead: %.1f%% of that\n", 100.0 * res.extra["timed_fraction"],
+           100.0 * res.extra["overhead_fraction"]);
+    if (measured <= overhead)
+    {
+        cout << "Warning: the overhead is all of the measured time, "
+                "not subtracting it" << endl;
+        return;
+    }
+    res.opsPerSec = res.ops / ((measured - overhead) / CLOCKS_PER_SEC);
+    printf("%.2f per second with the overhead subtracted%s\n", res.opsPerSec,
+           0.5 < res.extra["overhead_fraction"] ? " (mostly overhead, "
+           "take with a grain of salt)" : "");
+}
+
+// Like doBenchmark(), but with the batch size picked so that every
+// timed batch is at least a thousand timer ticks, warmup batches
+// discarded until the throughput stops drifting, and batches run until
+// the 95% confidence interval of the ops/sec is within autoCI of the
+// mean (or the time or atom budget runs out).
+BenchResult AtomSpaceBenchmark::doAutoBenchmark(const std::string& methodName,
+                                                BMFn methodToCall)
+{
+    setRepCounts(methodToCall);
+    // Methods that use up atoms are still bound by setRepCounts().
+    bool consumes = usesLeaves(methodToCall);
+    double opsBudget = consumes ? (double) Nreps * Nclock : 1.0e30;
+    // Keep batches small enough that growing them costs at most about
+    // a twentieth of the budget, and that warmup, capped at half of it,
+    // leaves room for plenty of measured batches.
+    const size_t MIN_BATCHES = 10;
+    unsigned int maxClock = 1 << 16;
+    if (consumes)
+        maxClock = std::max(1.0, std::min((double) maxClock,
+                   opsBudget / (4 * MIN_BATCHES * Nloops)));
+    Nclock = std::min(Nclock, maxClock);
+
+    if (perOpLatency and NULL == latencyHist)
+        latencyHist = new LatencyHistogram();
+    if (hwCounters and NULL == perfCounters)
+    {
+        perfCounters = new PerfCounters();
+        if (not perfCounters->available())
+        {
+            cout << "Hardware counters unavailable, continuing without: "
+                 << perfCounters->error() << endl;
+            delete perfCounters;
+            perfCounters = NULL;
+            hwCounters = false;
+        }
+    }
+
+    if (subtractOverhead and not overheadCalibrated) calibrateOverhead();
+
+    cout << "Benchmarking " << apiName() << "'s " << methodName
+         << " method, auto-calibrated ";
+
+    // Grow the batch until it clearly exceeds the timer resolution.
+    // The stack arrays in the bm_* methods put a cap on it.
+    clock_t resolution = timerResolution();
+    clock_t target = std::max((clock_t) 1000 * resolution,
+                              (clock_t) (CLOCKS_PER_SEC / 100));
+    double spent = 0.0;
+    std::vector<double> rates;
+    timeval tim;
+    gettimeofday(&tim, NULL);
+    double t1 = tim.tv_sec + (tim.tv_usec/1000000.0);
+    while (true)
+    {
+        clock_t taken = get<0>(CALL_MEMBER_FN(*this, methodToCall)());
+        spent += (double) Nclock * Nloops;
+        if (target <= taken or maxClock <= Nclock) break;
+        unsigned int grow = (0 < taken) ? 2 * target / taken : 16;
+        Nclock = std::min(Nclock * std::max(2u, std::min(grow, 16u)),
+                          maxClock);
+    }
+    double batchOps = (double) Nclock * Nloops;
+    double overhead = 0.0;
+    if (subtractOverhead and methodToCall != &AtomSpaceBenchmark::bm_noop)
+        overhead = regionOverhead();
+
+    // Warmup: run until the mean of the last five batches is within
+    // twice the target interval of the five before.
+    const size_t W = 5;
+    size_t warmup = 0;
+    double tolerance = std::max(2.0 * autoCI, 0.01);
+    bool stable = false;
+    while (spent + batchOps <= opsBudget / 2)
+    {
+        clock_t taken = get<0>(CALL_MEMBER_FN(*this, methodToCall)());
+        spent += batchOps;
+        rates.push_back(batchOps / (netTicks(taken, overhead) / CLOCKS_PER_SEC));
+        warmup++;
+        if (rates.size() < 2*W) continue;
+        double prev = mean(std::vector<double>(rates.end() - 2*W,
+                                               rates.end() - W));
+        double last = mean(std::vector<double>(rates.end() - W, rates.end()));
+        if (fabs(last - prev) <= tolerance * last) { stable = true; break; }
+        if (100 <= warmup) break;
+    }
+
+    // Measure, with the latency and counters for these batches only.
+    if (latencyHist) latencyHist->reset();
+    if (perfCounters) perfCounters->reset();
+    for (LatencyHistogram& hist : mixHist) hist.reset();
+    std::fill(mixCount.begin(), mixCount.end(), 0);
+    for (LookupGroup& g : lookupGroups) g.reset();
+    scanAtoms = 0;
+    scanTicks = 0;
+    rates.clear();
+    clock_t sumAsyncTime = 0;
+    double ci = 0.0;
+    bool converged = false;
+    while (spent + batchOps <= opsBudget)
+    {
+        clock_t taken = get<0>(CALL_MEMBER_FN(*this, methodToCall)());
+        spent += batchOps;
+        sumAsyncTime += taken;
+        rates.push_back(batchOps / (netTicks(taken, overhead) / CLOCKS_PER_SEC));
+        if (rates.size() % 10 == 0) cerr << "." << flush;
+
+        gettimeofday(&tim, NULL);
+        double elapsed = tim.tv_sec + (tim.tv_usec/1000000.0) - t1;
+        if (rates.size() < MIN_BATCHES) continue;
+        ci = confidence95(rates);
+        if (ci <= autoCI * mean(rates)) { converged = true; break; }
+        if (autoMaxSeconds <= elapsed) break;
+    }
+    gettimeofday(&tim, NULL);
+    double t2 = tim.tv_sec + (tim.tv_usec/1000000.0);
+    if (rates.empty())
+    {
+        cout << "\nNo atoms left to measure with; "
+                "try a larger AtomSpace (-s)" << endl;
+        BenchResult none;
+        none.method = methodName;
+        none.api = apiName();
+        return none;
+    }
+    ci = confidence95(rates);
+
+    BenchResult res;
+    res.method = methodName;
+    res.api = apiName();
+    res.ops = rates.size() * batchOps;
+    res.wallSeconds = t2-t1;
+    res.opsPerSec = res.ops / ((double) sumAsyncTime / CLOCKS_PER_SEC);
+    if (0.0 < overhead) removeOverhead(res, sumAsyncTime, rates.size());
+    res.samples.push_back(res.opsPerSec);
+    res.extra["ci95_halfwidth"] = ci;
+    res.extra["batch_size"] = batchOps;
+    res.extra["batches"] = rates.size();
+    res.extra["warmup_batches"] = warmup;
+    res.extra["timer_resolution_sec"] = (double) resolution / CLOCKS_PER_SEC;
+
+    printf("\n%.6lf seconds elapsed, timer resolution %.3g sec\n",
+           t2-t1, (double) resolution / CLOCKS_PER_SEC);
+    printf("%lu batches of %.0f ops, after %lu warmup batches%s\n",
+           (unsigned long) rates.size(), batchOps, (unsigned long) warmup,
+           stable ? "" : " (throughput did not stabilise)");
+    printf("%.2f per second +/- %.2f (95%% CI, +/-%.2f%%)%s\n",
+           res.opsPerSec, ci, 100.0 * ci / mean(rates),
+           converged ? "" : ", NOT within the target");
+    if (latencyHist)
+    {
+        printLatency(*latencyHist);
+        addLatency(res, *latencyHist);
+    }
+    if (perfCounters)
+    {
+        printPerfCounters(*perfCounters, res.ops);
+        addCounters(res, *perfCounters, res.ops);
+    }
+    if (methodToCall == &AtomSpaceBenchmark::bm_mix) printMix(res);
+    printLookup(res);
+    printScan(res);
+    cout << DIVIDER_LINE << endl;
+    return res;
 }
 
 // A totally bogus value for no particular reason
 #define UUID_PAD 1000
 
-void AtomSpaceBenchmark::startBenchmark(int numThreads)
+int AtomSpaceBenchmark::startBenchmark(int numThreads)
 {
     cout << "OpenCog Atomspace Benchmark - " << VERSION_STRING << "\n";
     cout << "\nRandom generator: MT19937\n";
-    cout << "Random seed: " << randomseed << "\n\n";
+    cout << "Random seed: " << randomseed << "\n";
+    cout << "Read access pattern: " << accessPattern.describe() << "\n\n";
 
     if (saveToFile) cout << "Ingnore this: " << global << std::endl;
 
+    // Rather than find out after hours of runs.
+    if (not compareFile.empty() and not readSamples(compareFile, baseline)) {
+        cerr << "Error: cannot read baseline " << compareFile << endl;
+        return 1;
+    }
+
     // Initialize the random number generator with the seed which might
     // have been passed in on the command line.
     if (randomGenerator)
@@ -463,59 +1155,1236 @@ void AtomSpaceBenchmark::startBenchmark(int numThreads)
     randomGenerator = new opencog::MT19937RandGen(randomseed);
 
     // Make sure we are using the correct link mean!
+    if (ArityDistribution::POISSON == arity.kind())
+        linkSize_mean = arity.mean();
     if (poissonDistribution) delete poissonDistribution;
     poissonDistribution = new std::poisson_distribution<unsigned>(linkSize_mean);
 
-    // num threads does nothing at the moment;
+    if (not recordFile.empty()) {
+        recorder = new TraceRecorder(recordFile);
+        if (not recorder->ok()) {
+            cerr << "Error: cannot record to " << recorder->error() << endl;
+            delete recorder;
+            recorder = NULL;
+            return 1;
+        }
+    }
+
+    if (not profilePrefix.empty()) {
+        delete profiler;
+        profiler = new SampleProfiler(profilePrefix, profileHz);
+    }
+
+    // Only removeAtom, and mixes that remove atoms, need the leaves;
+    // the pool costs a scan of the test atomspace they run on.
+    for (BMFn fn : methodsToTest)
+        if (usesLeaves(fn) and not leaves) leaves = new LeafPool();
+
     if (showTypeSizes) printTypeSizes();
+    if (memAccounting) measureAtomSizes();
+
+    runInfo.version = VERSION_STRING;
+    runInfo.seed = randomseed;
+    runInfo.atomCount = atomCount;
+    runInfo.percentLinks = percentLinks;
+    runInfo.nclock = baseNclock;
+    runInfo.nreps = baseNreps;
+    runInfo.access = accessPattern.describe();
+    runInfo.describeHost();
+    // Before the test atomspace fills the heap and the caches.
+    if (runProbes) {
+        runInfo.probes = runMachineProbes();
+        printMachineProbes(runInfo.probes);
+    }
+    if (0 == repetitions) repetitions = compareFile.empty() ? 1 : 5;
+
+    if (buildScaling) runBuildScaling();
+
+    // The size sweep runs the methods itself.
+    if (not sweepSizes.empty()) {
+        runSizeSweep(numThreads);
+        methodNames.clear();
+        methodsToTest.clear();
+    }
+
+    // Replaying a trace replaces them too.
+    if (not replayFile.empty()) {
+        if (not runReplay(numThreads)) {
+            delete profiler;
+            profiler = NULL;
+            delete leaves;
+            leaves = NULL;
+            return 1;
+        }
+        methodNames.clear();
+        methodsToTest.clear();
+    }
+
+    // The open-loop sweep replaces the usual closed-loop runs.
+    if (not openLoopRates.empty()) {
+        runOpenLoop(numThreads);
+        methodNames.clear();
+        methodsToTest.clear();
+    }
+
+    // So does the hub contention benchmark.
+    if (not hubCounts.empty()) {
+        runHubContention();
+        methodNames.clear();
+        methodsToTest.clear();
+    }
+
+    // And the duplicate insertion one.
+    int dupFailures = 0;
+    if (not dupOverlaps.empty()) {
+        dupFailures = runDupInsert(numThreads);
+        methodNames.clear();
+        methodsToTest.clear();
+    }
 
     for (unsigned int i = 0; i < methodNames.size(); i++) {
-        UUID_begin = 1;
-        UUID_end = tlbuf.size() + UUID_PAD;
-        if (testKind == BENCH_TABLE) {
-            atab = new AtomTable();
+        if (1 == numThreads) {
+            recordResult(repeatBenchmark(methodNames[i], methodsToTest[i], 1));
+            continue;
+        }
+
+        // Run the method on 1, 2, 4 ... numThreads workers, each time
+        // against a freshly built atomspace, so that the points are
+        // comparable with one-another.
+        std::vector<BenchResult> scaling;
+        for (int nt = 1; ; nt = std::min(2*nt, numThreads)) {
+            scaling.push_back(
+                repeatBenchmark(methodNames[i], methodsToTest[i], nt));
+            recordResult(scaling.back());
+            if (nt == numThreads) break;
         }
-        else {
-            asp = new AtomSpace();
+
+        cout << "Thread scaling for " << methodNames[i]
+             << " (ops/sec, timed regions only):" << endl;
+        printf("%8s %14s %14s %14s %14s %8s\n", "threads", "aggregate",
+               "per-thr min", "per-thr mean", "per-thr max", "speedup");
+        for (BenchResult& sp : scaling)
+            printf("%8d %14.0f %14.0f %14.0f %14.0f %8.2f\n", sp.threads,
+                   sp.opsPerSec, sp.extra["per_thread_min"],
+                   sp.extra["per_thread_mean"], sp.extra["per_thread_max"],
+                   sp.opsPerSec / scaling[0].opsPerSec);
+        cout << DIVIDER_LINE << endl;
+    }
+
+    if (recorder) {
+        size_t steps = recorder->close();
+        if (recorder->ok())
+            cout << "Recorded " << steps << " steps to " << recordFile << endl;
+        else
+            cerr << "Error: writing " << recordFile << ": "
+                 << recorder->error() << endl;
+        delete recorder;
+        recorder = NULL;
+    }
+
+    int rc = compareFile.empty() ? 0 : compareWithBaseline();
+    rc += dupFailures;
+    if (0 < failedRuns)
+        cerr << "Error: " << failedRuns << " isolated run(s) failed, "
+             << "and were left out of the results" << endl;
+    rc += failedRuns;
+    // The workers share these, so they are not deleted with them.
+    delete profiler;
+    profiler = NULL;
+    delete leaves;
+    leaves = NULL;
+    return rc;
+}
+
+// Run a method `repetitions` times, each time on a freshly built
+// atomspace, keeping the ops/sec of every repetition.
+BenchResult AtomSpaceBenchmark::repeatBenchmark(const std::string& methodName,
+                                                BMFn methodToCall,
+                                                int numThreads)
+{
+    std::vector<double> samples;
+    BenchResult res;
+    std::string profileName = 1 == numThreads ? methodName :
+        methodName + "@" + std::to_string(numThreads);
+    if (profiler and ISOLATE_NONE == isolation) profiler->start();
+    // Every child gets its own copy-on-write copy of this one.
+    if (ISOLATE_COW == isolation) setupAtomSpace();
+    for (int r = 0; r < repetitions; r++) {
+        if (ISOLATE_NONE == isolation) {
+            setupAtomSpace();
+            res = runOnce(methodName, methodToCall, numThreads);
+            teardownAtomSpace();
+        }
+        else if (not runIsolated(methodName, methodToCall, numThreads,
+                                 r, profileName, res)) {
+            // Not a sample of anything.
+            failedRuns++;
+            continue;
+        }
+        samples.push_back(res.opsPerSec);
+    }
+    if (ISOLATE_COW == isolation) teardownAtomSpace();
+    res.samples = samples;
+    res.opsPerSec = median(samples);
+    if (profiler and ISOLATE_NONE == isolation) profiler->stop(profileName);
+    return res;
+}
+
+BenchResult AtomSpaceBenchmark::runOnce(const std::string& methodName,
+                                        BMFn methodToCall, int numThreads)
+{
+    if (leaves and usesLeaves(methodToCall)) fillLeaves();
+    if (1 == numThreads and autoCalibrate)
+        return doAutoBenchmark(methodName, methodToCall);
+    if (1 == numThreads)
+        return doBenchmark(methodName, methodToCall);
+    return doThreadedBenchmark(methodName, methodToCall, numThreads);
+}
+
+// Run one repetition in a forked child, so that it starts either from
+// a heap that no earlier method has touched (ISOLATE_CLEAN builds the
+// test atomspace in the child) or from the parent's pre-built atomspace
+// (ISOLATE_COW). The child sends its result, with its memory use, page
+// faults and context switches, back over a pipe. Returns false if there
+// is no result, because the child could not be started, died, or sent
+// nothing back.
+bool AtomSpaceBenchmark::runIsolated(const std::string& methodName,
+                                     BMFn methodToCall, int numThreads,
+                                     int rep, const std::string& profileName,
+                                     BenchResult& res)
+{
+    res = BenchResult();
+    res.method = methodName;
+    res.api = apiName();
+    res.threads = numThreads;
+
+    int fd[2];
+    if (pipe(fd))
+    {
+        perror("pipe");
+        return false;
+    }
+    // Or the child would print whatever is still buffered once more.
+    cout << flush;
+    cerr << flush;
+    fflush(NULL);
+    pid_t pid = fork();
+    if (pid < 0)
+    {
+        perror("fork");
+        close(fd[0]);
+        close(fd[1]);
+        return false;
+    }
+
+    if (0 == pid)
+    {
+        close(fd[0]);
+        // Otherwise every repetition would make the same random choices.
+        delete randomGenerator;
+        randomGenerator = new opencog::MT19937RandGen(randomseed + 1 + rep);
+        if (ISOLATE_CLEAN == isolation) setupAtomSpace();
+        if (profiler) profiler->start();
+        res = runOnce(methodName, methodToCall, numThreads);
+        if (profiler) profiler->stop(profileName);
+
+        long pages = 0, resident = 0;
+        FILE* statm = fopen("/proc/self/statm", "r");
+        if (statm)
+        {
+            if (2 != fscanf(statm, "%ld %ld", &pages, &resident))
+                resident = 0;
+            fclose(statm);
+        }
+        struct rusage ru;
+        getrusage(RUSAGE_SELF, &ru);
+        res.extra["rss_bytes"] = (double) resident * sysconf(_SC_PAGESIZE);
+        res.extra["peak_rss_bytes"] = (double) ru.ru_maxrss * 1024;
+        res.extra["minor_faults"] = ru.ru_minflt;
+        res.extra["major_faults"] = ru.ru_majflt;
+        res.extra["voluntary_ctx_switches"] = ru.ru_nvcsw;
+        res.extra["involuntary_ctx_switches"] = ru.ru_nivcsw;
+
+        std::ostringstream out;
+        writeResult(out, res);
+        std::string msg = out.str();
+        const char* p = msg.c_str();
+        size_t left = msg.size();
+        while (0 < left)
+        {
+            ssize_t n = write(fd[1], p, left);
+            if (n <= 0) break;
+            p += n;
+            left -= n;
+        }
+        cout << flush;
+        fflush(NULL);
+        // Skip the destructors; the parent still owns all of that.
+        _exit(0 == left ? 0 : 1);
+    }
+
+    close(fd[1]);
+    std::string msg;
+    char buf[4096];
+    ssize_t n;
+    while (0 < (n = read(fd[0], buf, sizeof(buf))) or
+           (n < 0 and EINTR == errno))
+        if (0 < n) msg.append(buf, n);
+    close(fd[0]);
+    int status = 0;
+    while (waitpid(pid, &status, 0) < 0 and EINTR == errno) {}
+
+    std::istringstream in(msg);
+    if (not WIFEXITED(status) or 0 != WEXITSTATUS(status) or
+        not readResult(in, res))
+    {
+        if (WIFSIGNALED(status))
+            cerr << "Error: the child running " << methodName
+                 << " died of signal " << WTERMSIG(status) << endl;
+        else
+            cerr << "Error: the child running " << methodName
+                 << " did not send back a result" << endl;
+        return false;
+    }
+    printf("Child process: RSS %.0f KB (peak %.0f KB), page faults %.0f "
+           "minor %.0f major, context switches %.0f voluntary "
+           "%.0f involuntary\n",
+           res.extra["rss_bytes"] / 1024, res.extra["peak_rss_bytes"] / 1024,
+           res.extra["minor_faults"], res.extra["major_faults"],
+           res.extra["voluntary_ctx_switches"],
+           res.extra["involuntary_ctx_switches"]);
+    return true;
+}
+
+void AtomSpaceBenchmark::recordResult(const BenchResult& res)
+{
+    // Every isolated run of it failed.
+    if (res.samples.empty()) return;
+    results.push_back(res);
+    if (jsonFile.empty()) return;
+
+    std::ofstream out(jsonFile, std::ios::app);
+    if (not out)
+    {
+        cerr << "Error: cannot write to " << jsonFile << endl;
+        return;
+    }
+    writeJson(out, runInfo, res);
+}
+
+// Compare the results of this run against the samples in a baseline
+// file written with -j, read at the start, using the Mann-Whitney U
+// test. Returns the number of methods that got significantly slower.
+int AtomSpaceBenchmark::compareWithBaseline()
+{
+    printf("Comparison against %s (Mann-Whitney U, alpha = %g):\n",
+           compareFile.c_str(), compareAlpha);
+    printf("%-24s %14s %14s %9s %9s  %s\n", "method", "baseline",
+           "current", "change", "p-value", "verdict");
+    int regressions = 0;
+    for (const BenchResult& res : results)
+    {
+        std::string key = res.method;
+        if (1 != res.threads) key += "@" + std::to_string(res.threads);
+        auto it = baseline.find(key);
+        if (it == baseline.end() or it->second.empty())
+        {
+            printf("%-24s %14s %14.0f %9s %9s  not in baseline\n",
+                   key.c_str(), "-", res.opsPerSec, "-", "-");
+            continue;
+        }
+        double base = median(it->second);
+        double change = 100.0 * (res.opsPerSec / base - 1.0);
+        double p = mannWhitney(it->second, res.samples);
+        const char* verdict = "no significant change";
+        if (p < compareAlpha)
+        {
+            if (res.opsPerSec < base)
+            {
+                verdict = "REGRESSION";
+                regressions++;
+            }
+            else verdict = "improvement";
+        }
+        printf("%-24s %14.0f %14.0f %+8.2f%% %9.4f  %s\n", key.c_str(),
+               base, res.opsPerSec, change, p, verdict);
+    }
+    if (repetitions < 4)
+        cout << "Note: with fewer than 4 repetitions (--reps), no "
+                "difference can be significant." << endl;
+    cout << DIVIDER_LINE << endl;
+    return regressions;
+}
+
+void AtomSpaceBenchmark::setupAtomSpace()
+{
+    // The TLB outlives the atomspace, so skip the atoms of the ones
+    // built for earlier repetitions and methods.
+    UUID_begin = tlbuf.size() + 1;
+    UUID_end = tlbuf.size() + UUID_PAD;
+    if (testKind == BENCH_TABLE) {
+        atab = new AtomTable();
+    }
+    else {
+        asp = new AtomSpace();
 #if HAVE_CYTHON
-            pyev = new PythonEval();
-            // And now ... create a Python instance of the atomspace.
-            // Pass in the raw C++ atomspace address into cython.
-            // Kind-of tacky, but I don't see any better way.
-            // (We must do this because otherwise, the benchmark would
-            // run on a different atomspace, than the one containing
-            // all the atoms.  And that would give bad results.
-            std::ostringstream dss;
-            dss << "from atomspace import AtomSpace, types, TruthValue, Atom" << std::endl;
-            dss << "aspace = AtomSpace(" << asp << ")" << std::endl;
-            pyev->eval(dss.str());
+        pyev = new PythonEval();
+        // And now ... create a Python instance of the atomspace.
+        // Pass in the raw C++ atomspace address into cython.
+        // Kind-of tacky, but I don't see any better way.
+        // (We must do this because otherwise, the benchmark would
+        // run on a different atomspace, than the one containing
+        // all the atoms.  And that would give bad results.
+        std::ostringstream dss;
+        dss << "from atomspace import AtomSpace, types, TruthValue, Atom" << std::endl;
+        dss << "aspace = AtomSpace(" << asp << ")" << std::endl;
+        pyev->eval(dss.str());
 #endif
 #if HAVE_GUILE
-            scm = new SchemeEval(asp);
+        scm = new SchemeEval(asp);
 #endif
-        }
-        numberOfTypes = nameserver().getNumberOfClasses();
+    }
+    numberOfTypes = nameserver().getNumberOfClasses();
 
-        if (buildTestData) buildAtomSpace(atomCount, percentLinks, false);
-        UUID_end = tlbuf.size() + UUID_PAD;
+    size_t heapBefore = liveHeapBytes();
+    if (buildTestData)
+    {
+        if (snapshotDir.empty())
+            generateAtomSpace();
+        else if (not restoreSnapshot())
+            snapshotAtomSpace();
+    }
+    UUID_end = tlbuf.size() + UUID_PAD;
+    if (buildTestData and memAccounting)
+        printTypeBreakdown(liveHeapBytes() - heapBefore);
+    // Those of the last atomspace; fillLeaves() refills it when needed.
+    if (leaves) leaves->clear();
+}
 
-        doBenchmark(methodNames[i], methodsToTest[i]);
+// The methods that take the atoms they remove from the leaf pool.
+bool AtomSpaceBenchmark::usesLeaves(BMFn methodToCall) const
+{
+    return methodToCall == &AtomSpaceBenchmark::bm_rmAtom or
+        (methodToCall == &AtomSpaceBenchmark::bm_mix and
+         not mixWeights.empty() and 0.0 < mixWeights[MIX_REMOVE_ATOM]);
+}
 
-        if (testKind == BENCH_TABLE)
-            delete atab;
-        else {
+// Offer every atom of the test atomspace to the leaf pool; called after
+// setupAtomSpace(), only before a method that uses the pool.
+void AtomSpaceBenchmark::fillLeaves()
+{
+    HandleSeq atoms;
+    if (testKind == BENCH_TABLE)
+        atab->getHandlesByType(std::back_inserter(atoms), ATOM, true);
+    else
+        asp->get_handles_by_type(atoms, ATOM, true);
+    leaves->clear();
+    for (const Handle& h : atoms) leaves->offer(h);
+}
+
+// The seed and every parameter that buildAtomSpace() depends on.
+std::string AtomSpaceBenchmark::snapshotKey() const
+{
+    std::ostringstream oss;
+    oss << "seed=" << randomseed << ";atoms=" << atomCount
+        << ";links=" << percentLinks << ";arity=" << linkSize_mean
+        << ";node=" << nameserver().getTypeName(defaultNodeType)
+        << ":" << chanceOfNonDefaultNode
+        << ";link=" << nameserver().getTypeName(defaultLinkType)
+        << ":" << chanceOfNonDefaultLink
+        << ";tv=" << chanceUseDefaultTV;
+    // The parallel builder makes a different graph for each count.
+    if (parallelBuild()) oss << ";threads=" << buildThreads;
+    if (GraphShape::UNIFORM != graphShape.kind())
+        oss << ";graph=" << graphShape.describe();
+    if (ArityDistribution::POISSON != arity.kind())
+        oss << ";arities=" << arity.describe();
+    return oss.str();
+}
+
+std::string AtomSpaceBenchmark::snapshotPath() const
+{
+    // FNV-1a, to keep the file name short.
+    uint64_t hash = 14695981039346656037ULL;
+    for (char c : snapshotKey())
+        hash = (hash ^ (unsigned char) c) * 1099511628211ULL;
+    char name[64];
+    snprintf(name, sizeof(name), "/atomspace-%016llx.snap",
+             (unsigned long long) hash);
+    return snapshotDir + name;
+}
+
+// Fill the test atomspace from the snapshot, if there is one.
+bool AtomSpaceBenchmark::restoreSnapshot()
+{
+    NodeAdder addNode;
+    LinkAdder addLink;
+    if (testKind == BENCH_TABLE) {
+        addNode = [this](Type t, std::string&& name) {
+            return atab->add(createNode(t, std::move(name)), false); };
+        addLink = [this](Type t, HandleSeq&& oset) {
+            return atab->add(createLink(std::move(oset), t), false); };
+    }
+    else {
+        addNode = [this](Type t, std::string&& name) {
+            return asp->add_node(t, std::move(name)); };
+        addLink = [this](Type t, HandleSeq&& oset) {
+            return asp->add_link(t, std::move(oset)); };
+    }
+
+    SnapshotInfo info;
+    info.key = snapshotKey();
+    HandleSeq added;
+    uint64_t t1 = monotonic_ns();
+    if (not readSnapshot(snapshotPath(), info, addNode, addLink, added))
+        return false;
+    // The nodes come first, as in buildAtomSpace().
+    for (const Handle& h : added)
+        tlbuf.addAtom(h, TLB::INVALID_UUID);
+    UUID_end = tlbuf.size() + UUID_PAD;
+    double secs = (monotonic_ns() - t1) / 1.0e9;
+
+    // Keep clear of the node names in the snapshot.
+    counter = std::max(counter, info.counter);
+    printf("Restored %lu atoms from %s in %.3f seconds "
+           "(generating them took %.3f seconds)\n",
+           (unsigned long) info.atoms, snapshotPath().c_str(), secs,
+           info.buildSeconds);
+    runInfo.extra["restore_seconds"] = secs;
+    runInfo.extra["generate_seconds"] = info.buildSeconds;
+    return true;
+}
+
+// Generate the test atomspace and save a snapshot of it. It is built
+// with a freshly seeded generator, so that it depends only on what is
+// in the key, and not on what ran before.
+void AtomSpaceBenchmark::snapshotAtomSpace()
+{
+    MT19937RandGen* saveGenerator = randomGenerator;
+    long saveCounter = counter;
+    randomGenerator = new opencog::MT19937RandGen(randomseed);
+    counter = 0;
+
+    double secs = generateAtomSpace();
+
+    SnapshotInfo info;
+    info.key = snapshotKey();
+    info.buildSeconds = secs;
+    info.counter = counter;
+    delete randomGenerator;
+    randomGenerator = saveGenerator;
+    counter = std::max(saveCounter, counter);
+
+    HandleSeq atoms;
+    if (testKind == BENCH_TABLE)
+        atab->getHandlesByType(std::back_inserter(atoms), ATOM, true);
+    else
+        asp->get_handles_by_type(atoms, ATOM, true);
+    if (writeSnapshot(snapshotPath(), info, atoms))
+        printf("Generated %lu atoms in %.3f seconds, saved to %s\n",
+               (unsigned long) atoms.size(), secs, snapshotPath().c_str());
+    else
+        cerr << "Warning: cannot write snapshot " << snapshotPath() << endl;
+    runInfo.extra["generate_seconds"] = secs;
+}
+
+void AtomSpaceBenchmark::teardownAtomSpace()
+{
+    valueKeys.clear();
+    if (testKind == BENCH_TABLE)
+        delete atab;
+    else {
 #if HAVE_GUILE
-            delete scm;
+        delete scm;
 #endif
 #if HAVE_CYTHON
-            delete pyev;
+        delete pyev;
 #endif
-            delete asp;
+        delete asp;
+    }
+}
+
+// A worker is a shallow copy of this benchmark, with its own random
+// generator (and so its own pre-generated handles) and its own range
+// of node names, so that addNode workers don't collide.
+AtomSpaceBenchmark* AtomSpaceBenchmark::makeWorker(int t, int numThreads)
+{
+    AtomSpaceBenchmark* w = new AtomSpaceBenchmark(*this);
+    w->randomGenerator = new opencog::MT19937RandGen(randomseed + 1 + t);
+    w->poissonDistribution =
+        new std::poisson_distribution<unsigned>(linkSize_mean);
+    w->counter = counter + ((long) (t + 1) << 40);
+    w->global = 0;
+    w->nThreads = numThreads;
+    w->workerIndex = t;
+    w->latencyHist = perOpLatency ? new LatencyHistogram() : NULL;
+    for (LatencyHistogram& hist : w->mixHist) hist.reset();
+    std::fill(w->mixCount.begin(), w->mixCount.end(), 0);
+    for (LookupGroup& g : w->lookupGroups) g.reset();
+    w->scanAtoms = 0;
+    w->scanTicks = 0;
+    // Counters only count the thread that opened them, so each
+    // worker opens its own.
+    w->perfCounters = NULL;
+    return w;
+}
+
+// Run methodToCall on numThreads workers, all hitting the same asp or
+// atab.
+BenchResult
+AtomSpaceBenchmark::doThreadedBenchmark(const std::string& methodName,
+                                        BMFn methodToCall, int numThreads)
+{
+    setRepCounts(methodToCall);
+    unsigned int perWorkerReps = Nreps / numThreads;
+    if (0 == perWorkerReps) perWorkerReps = 1;
+
+    cout << "Benchmarking "
+         << (testKind == BENCH_TABLE ? "AtomTable's " : "AtomSpace's ")
+         << methodName << " method " << (Nclock*perWorkerReps*numThreads)
+         << " times on " << numThreads << " thread(s) ";
+
+    std::vector<AtomSpaceBenchmark*> workers;
+    for (int t = 0; t < numThreads; t++) {
+        AtomSpaceBenchmark* w = makeWorker(t, numThreads);
+        w->Nreps = perWorkerReps;
+        workers.push_back(w);
+    }
+
+    std::vector<clock_t> sumTime(numThreads, 0);
+    std::atomic<int> ready(0);
+    std::atomic<bool> go(false);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < numThreads; t++) {
+        threads.emplace_back([&, t]() {
+            AtomSpaceBenchmark* w = workers[t];
+            if (hwCounters) w->perfCounters = new PerfCounters();
+            ready++;
+            while (not go) std::this_thread::yield();
+            for (unsigned int i = 0; i < w->Nreps; i++)
+                sumTime[t] += get<0>(CALL_MEMBER_FN(*w, methodToCall)());
+        });
+    }
+
+    while (ready < numThreads) std::this_thread::yield();
+    timeval tim;
+    gettimeofday(&tim, NULL);
+    double t1 = tim.tv_sec + (tim.tv_usec/1000000.0);
+    go = true;
+    for (std::thread& th : threads) th.join();
+    gettimeofday(&tim, NULL);
+    double t2 = tim.tv_sec + (tim.tv_usec/1000000.0);
+
+    double aggregate = 0.0;
+    double perThreadMin = 1.0e30;
+    double perThreadMax = 0.0;
+    LatencyHistogram merged;
+    PerfCounters* counters = NULL;
+    for (LatencyHistogram& hist : mixHist) hist.reset();
+    std::fill(mixCount.begin(), mixCount.end(), 0);
+    for (LookupGroup& g : lookupGroups) g.reset();
+    scanAtoms = 0;
+    scanTicks = 0;
+    for (int t = 0; t < numThreads; t++) {
+        double secs = (double) sumTime[t] / CLOCKS_PER_SEC;
+        double rate = (secs > 0.0) ? (perWorkerReps * Nclock) / secs : 0.0;
+        aggregate += rate;
+        perThreadMin = std::min(perThreadMin, rate);
+        perThreadMax = std::max(perThreadMax, rate);
+        global += workers[t]->global;
+        if (workers[t]->latencyHist) merged.merge(*workers[t]->latencyHist);
+        for (size_t op = 0; op < mixHist.size(); op++)
+        {
+            mixHist[op].merge(workers[t]->mixHist[op]);
+            mixCount[op] += workers[t]->mixCount[op];
+        }
+        for (size_t hit = 0; hit < lookupGroups.size(); hit++)
+            lookupGroups[hit].merge(workers[t]->lookupGroups[hit]);
+        // The workers scan at the same time.
+        scanAtoms += workers[t]->scanAtoms;
+        scanTicks = std::max(scanTicks, workers[t]->scanTicks);
+        if (workers[t]->perfCounters and workers[t]->perfCounters->available())
+        {
+            if (counters)
+                counters->merge(*workers[t]->perfCounters);
+            else
+            {
+                counters = workers[t]->perfCounters;
+                workers[t]->perfCounters = NULL;
+            }
+        }
+        delete workers[t];
+    }
+
+    BenchResult res;
+    res.method = methodName;
+    res.api = apiName();
+    res.threads = numThreads;
+    res.ops = perWorkerReps*Nclock*numThreads;
+    res.wallSeconds = t2-t1;
+    res.opsPerSec = aggregate;
+    res.samples.push_back(aggregate);
+    res.extra["per_thread_min"] = perThreadMin;
+    res.extra["per_thread_mean"] = aggregate / numThreads;
+    res.extra["per_thread_max"] = perThreadMax;
+
+    printf("\n%.6lf seconds elapsed, %.2f per second aggregate, "
+           "%.2f per second per thread\n",
+           t2-t1, aggregate, aggregate / numThreads);
+    if (perOpLatency)
+    {
+        printLatency(merged);
+        addLatency(res, merged);
+    }
+    if (counters)
+    {
+        printPerfCounters(*counters, res.ops);
+        addCounters(res, *counters, res.ops);
+    }
+    else if (hwCounters) cout << "Hardware counters unavailable" << endl;
+    delete counters;
+    if (methodToCall == &AtomSpaceBenchmark::bm_mix) printMix(res);
+    printLookup(res);
+    printScan(res);
+    cout << DIVIDER_LINE << endl;
+    return res;
+}
+
+// Parse the target rates for -O: either a list, "1000,2000,5000", or a
+// geometric range "from:to:factor", e.g. "1000:1000000:2".
+bool AtomSpaceBenchmark::setRates(const std::string& spec)
+{
+    openLoopRates.clear();
+    if (std::count(spec.begin(), spec.end(), ':') == 2)
+    {
+        double from, to, factor;
+        if (3 != sscanf(spec.c_str(), "%lf:%lf:%lf", &from, &to, &factor)
+            or from <= 0.0 or to < from or factor <= 1.0)
+        {
+            cerr << "Error: bad rate range: " << spec << endl;
+            return false;
         }
+        for (double r = from; r <= to * 1.000001; r *= factor)
+            openLoopRates.push_back(r);
+        return true;
     }
 
-    //cout << estimateOfAtomSize(Handle(2)) << endl;
-    //cout << estimateOfAtomSize(Handle(1020)) << endl;
+    std::istringstream iss(spec);
+    std::string item;
+    while (std::getline(iss, item, ','))
+    {
+        double r = atof(item.c_str());
+        if (r <= 0.0)
+        {
+            cerr << "Error: bad rate: " << item << endl;
+            return false;
+        }
+        openLoopRates.push_back(r);
+    }
+    return not openLoopRates.empty();
+}
+
+// Wait until the given time on the monotonic clock. Sleep while it is
+// far away, and spin for the last stretch, as sleeps overshoot.
+static void waitUntil(uint64_t when)
+{
+    uint64_t now = monotonic_ns();
+    while (now < when)
+    {
+        if (200000 < when - now)
+            std::this_thread::sleep_for(
+                std::chrono::nanoseconds(when - now - 100000));
+        now = monotonic_ns();
+    }
+}
+
+// Open-loop run of the operation mix at a fixed target rate, spread
+// over numThreads workers. Operations are issued on a fixed schedule;
+// latency is measured from the time an operation was due, not from
+// when it got started, so a stall delays the start of all the ops
+// queued behind it and that delay is counted (no coordinated omission).
+BenchResult AtomSpaceBenchmark::doOpenLoop(double rate, int numThreads)
+{
+    size_t total = (size_t) (rate * openLoopSeconds);
+    if (total < (size_t) numThreads) total = numThreads;
+    size_t perWorker = total / numThreads;
+    double interval = 1.0e9 * numThreads / rate;
+
+    cout << "Open-loop mix at " << rate << " ops/sec for "
+         << openLoopSeconds << " seconds on " << numThreads
+         << " thread(s) " << flush;
+
+    std::vector<AtomSpaceBenchmark*> workers;
+    std::vector<LatencyHistogram> response(numThreads);
+    std::vector<uint64_t> lastEnd(numThreads, 0);
+    for (int t = 0; t < numThreads; t++)
+        workers.push_back(makeWorker(t, numThreads));
+
+    std::atomic<int> ready(0);
+    std::atomic<uint64_t> start(0);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < numThreads; t++) {
+        threads.emplace_back([&, t]() {
+            AtomSpaceBenchmark* w = workers[t];
+            std::vector<MixStep> steps(perWorker);
+            for (MixStep& st : steps) w->prepareMixStep(st);
+            ready++;
+            while (0 == start) std::this_thread::yield();
+            if (profiler) SampleProfiler::resume();
+
+            // Stagger the workers, so that together they issue
+            // evenly spaced operations.
+            double due = start + interval * t / numThreads;
+            int sum = 0;
+            for (MixStep& st : steps)
+            {
+                uint64_t intended = (uint64_t) due;
+                waitUntil(intended);
+                uint64_t op_begin = monotonic_ns();
+                sum += w->runMixStep(st);
+                uint64_t op_end = monotonic_ns();
+                response[t].record(op_end - intended);
+                w->mixHist[st.op].record(op_end - op_begin);
+                w->mixCount[st.op]++;
+                due += interval;
+                lastEnd[t] = op_end;
+            }
+            w->global += sum;
+            for (MixStep& st : steps)
+                if (MIX_REMOVE_ATOM == st.op) leaves->removed(st.h);
+            if (profiler) SampleProfiler::pause();
+        });
+    }
+
+    while (ready < numThreads) std::this_thread::yield();
+    // Give every thread a moment to see the start time.
+    uint64_t t0 = monotonic_ns() + 1000000;
+    start = t0;
+    for (std::thread& th : threads) th.join();
+
+    LatencyHistogram merged;
+    uint64_t t1 = t0;
+    for (LatencyHistogram& hist : mixHist) hist.reset();
+    std::fill(mixCount.begin(), mixCount.end(), 0);
+    for (int t = 0; t < numThreads; t++) {
+        merged.merge(response[t]);
+        for (size_t op = 0; op < mixHist.size(); op++)
+        {
+            mixHist[op].merge(workers[t]->mixHist[op]);
+            mixCount[op] += workers[t]->mixCount[op];
+        }
+        global += workers[t]->global;
+        t1 = std::max(t1, lastEnd[t]);
+        delete workers[t];
+    }
+
+    BenchResult res;
+    res.method = "open-loop:" + std::to_string((long) rate);
+    res.api = apiName();
+    res.threads = numThreads;
+    res.ops = perWorker * numThreads;
+    res.wallSeconds = (t1 - t0) / 1.0e9;
+    res.opsPerSec = res.ops / res.wallSeconds;
+    res.samples.push_back(res.opsPerSec);
+    res.extra["target_rate"] = rate;
+    addLatency(res, merged);
+
+    printf("\n%.6lf seconds elapsed, %.2f per second achieved\n",
+           res.wallSeconds, res.opsPerSec);
+    cout << "Response time, from when each operation was due:" << endl;
+    printLatency(merged);
+    printMix(res);
+    cout << DIVIDER_LINE << endl;
+    return res;
+}
+
+// Sweep the target rates, each on a freshly built atomspace, and print
+// the throughput-vs-latency curve.
+void AtomSpaceBenchmark::runOpenLoop(int numThreads)
+{
+    std::vector<BenchResult> curve;
+    for (double rate : openLoopRates) {
+        setupAtomSpace();
+        if (leaves and usesLeaves(&AtomSpaceBenchmark::bm_mix)) fillLeaves();
+        if (profiler) profiler->start();
+        curve.push_back(doOpenLoop(rate, numThreads));
+        if (profiler) profiler->stop(curve.back().method);
+        teardownAtomSpace();
+        recordResult(curve.back());
+    }
+
+    cout << "Throughput vs. response time (nanoseconds):" << endl;
+    printf("%12s %12s %10s %10s %10s %10s %12s\n", "target/sec",
+           "achieved/sec", "p50", "p90", "p99", "p99.9", "max");
+    for (BenchResult& pt : curve)
+        printf("%12.0f %12.0f %10.0f %10.0f %10.0f %10.0f %12.0f\n",
+               pt.extra["target_rate"], pt.opsPerSec, pt.latency.p50,
+               pt.latency.p90, pt.latency.p99, pt.latency.p999,
+               pt.latency.max);
+    cout << DIVIDER_LINE << endl;
+}
+
+// Parse "<readers>:<writers>:<hubs>", each a comma-separated list.
+bool AtomSpaceBenchmark::setHubContention(const std::string& spec)
+{
+    std::vector<int>* lists[] = { &hubReaders, &hubWriters, &hubCounts };
+    std::istringstream iss(spec);
+    std::string field;
+    int n = 0;
+    for (; n < 3 and std::getline(iss, field, ':'); n++)
+    {
+        std::istringstream fss(field);
+        std::string item;
+        lists[n]->clear();
+        while (std::getline(fss, item, ','))
+        {
+            char* end;
+            long v = strtol(item.c_str(), &end, 10);
+            if (item.empty() or *end or v < (2 == n ? 1 : 0))
+            {
+                cerr << "Error: bad hub contention count: " << item << endl;
+                return false;
+            }
+            lists[n]->push_back(v);
+        }
+        if (lists[n]->empty()) break;
+    }
+    if (3 != n or not iss.eof())
+    {
+        cerr << "Error: --hubs needs <readers>:<writers>:<hubs>, e.g."
+                " 1,4:1,4:1,64" << endl;
+        return false;
+    }
+    return true;
+}
+
+// Writers add links from new nodes to random hubs, while readers get
+// the incoming sets of random hubs, or their sizes, alternately, all
+// as fast as they can for openLoopSeconds. Every operation is timed.
+BenchResult AtomSpaceBenchmark::doHubContention(int readers, int writers,
+                                                int hubs)
+{
+    int numThreads = readers + writers;
+    cout << "Hub contention: " << readers << " reader(s), " << writers
+         << " writer(s) on " << hubs << " hub(s) for " << openLoopSeconds
+         << " seconds " << flush;
+
+    HandleSeq hubAtoms;
+    for (int i = 0; i < hubs; i++)
+        hubAtoms.push_back(addGraphAtom(CONCEPT_NODE,
+                                        "hub-" + std::to_string(i)));
+
+    // Per thread: getIncomingSet, getIncomingSetSize, add_link.
+    enum { GET_SET, GET_SIZE, ADD_LINK, NUM_HUB_OPS };
+    std::vector<std::array<LatencyHistogram, NUM_HUB_OPS>> hist(numThreads);
+    std::vector<AtomSpaceBenchmark*> workers;
+    for (int t = 0; t < numThreads; t++)
+        workers.push_back(makeWorker(t, numThreads));
+
+    std::atomic<int> ready(0);
+    std::atomic<bool> go(false), stop(false);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < numThreads; t++) {
+        threads.emplace_back([&, t]() {
+            AtomSpaceBenchmark* w = workers[t];
+            auto& h = hist[t];
+            ready++;
+            while (not go) std::this_thread::yield();
+            if (profiler) SampleProfiler::resume();
+            size_t sum = 0;
+            for (unsigned long i = 0; not stop.load(std::memory_order_relaxed);
+                 i++)
+            {
+                const Handle& hub =
+                    hubAtoms[w->randomGenerator->randint(hubs)];
+                uint64_t op_begin;
+                if (t < readers and i % 2 == 0)
+                {
+                    op_begin = monotonic_ns();
+                    sum += hub->getIncomingSet().size();
+                    h[GET_SET].record(monotonic_ns() - op_begin);
+                }
+                else if (t < readers)
+                {
+                    op_begin = monotonic_ns();
+                    sum += hub->getIncomingSetSize();
+                    h[GET_SIZE].record(monotonic_ns() - op_begin);
+                }
+                else
+                {
+                    Handle leaf = w->addGraphAtom(CONCEPT_NODE,
+                        "hub-leaf-" + std::to_string(w->counter++));
+                    op_begin = monotonic_ns();
+                    w->addGraphAtom(LIST_LINK, HandleSeq({leaf, hub}));
+                    h[ADD_LINK].record(monotonic_ns() - op_begin);
+                }
+            }
+            w->global += sum;
+            if (profiler) SampleProfiler::pause();
+        });
+    }
+    while (ready < numThreads) std::this_thread::yield();
+    uint64_t t0 = monotonic_ns();
+    go = true;
+    waitUntil(t0 + (uint64_t) (openLoopSeconds * 1.0e9));
+    stop = true;
+    for (std::thread& th : threads) th.join();
+    uint64_t t1 = monotonic_ns();
+
+    std::array<LatencyHistogram, NUM_HUB_OPS> merged;
+    for (int t = 0; t < numThreads; t++) {
+        for (int op = 0; op < NUM_HUB_OPS; op++) merged[op].merge(hist[t][op]);
+        global += workers[t]->global;
+        delete workers[t];
+    }
+    LatencyHistogram reads;
+    reads.merge(merged[GET_SET]);
+    reads.merge(merged[GET_SIZE]);
+
+    BenchResult res;
+    res.method = "hubs:r" + std::to_string(readers) + ":w" +
+                 std::to_string(writers) + ":h" + std::to_string(hubs);
+    res.api = apiName();
+    res.threads = numThreads;
+    res.ops = reads.count() + merged[ADD_LINK].count();
+    res.wallSeconds = (t1 - t0) / 1.0e9;
+    res.opsPerSec = res.ops / res.wallSeconds;
+    res.samples.push_back(res.opsPerSec);
+    res.extra["readers"] = readers;
+    res.extra["writers"] = writers;
+    res.extra["hubs"] = hubs;
+    // The largest incoming set the readers got to see.
+    size_t largest = 0;
+    for (const Handle& hub : hubAtoms)
+        largest = std::max(largest, hub->getIncomingSetSize());
+    res.extra["max_incoming"] = largest;
+    // The overall latency is that of the readers, who are the ones
+    // waiting on the writers.
+    addLatency(res, reads);
+
+    printf("\n%.6lf seconds elapsed, %.2f per second in all\n",
+           res.wallSeconds, res.opsPerSec);
+    static const char* names[] = {
+        "getIncomingSet", "getIncomingSetSize", "addLink" };
+    static const char* keys[] = {
+        "incoming_set", "incoming_set_size", "add_link" };
+    for (int op = 0; op < NUM_HUB_OPS; op++) {
+        const LatencyHistogram& lh = merged[op];
+        if (0 == lh.count()) continue;
+        std::string key = keys[op];
+        res.extra[key + "_ops_per_sec"] = lh.count() / res.wallSeconds;
+        res.extra[key + "_p50_ns"] = lh.percentile(50.0);
+        res.extra[key + "_p99_ns"] = lh.percentile(99.0);
+        res.extra[key + "_p999_ns"] = lh.percentile(99.9);
+        res.extra[key + "_max_ns"] = lh.max();
+        printf("%s: %.2f per second\n", names[op],
+               lh.count() / res.wallSeconds);
+        printLatency(lh);
+    }
+    cout << "Largest incoming set: " << largest << endl;
+    cout << DIVIDER_LINE << endl;
+    return res;
+}
+
+// Every combination of readers, writers and hubs, each on a freshly
+// built atomspace, then a table of the read and write throughput and
+// tail latencies.
+void AtomSpaceBenchmark::runHubContention()
+{
+    std::vector<BenchResult> points;
+    for (int hubs : hubCounts)
+    for (int writers : hubWriters)
+    for (int readers : hubReaders) {
+        if (0 == readers + writers) continue;
+        setupAtomSpace();
+        if (profiler) profiler->start();
+        points.push_back(doHubContention(readers, writers, hubs));
+        if (profiler) profiler->stop(points.back().method);
+        teardownAtomSpace();
+        recordResult(points.back());
+    }
+
+    cout << "Hub contention (latencies in nanoseconds; reads are"
+            " getIncomingSet and getIncomingSetSize):" << endl;
+    printf("%4s %4s %6s %12s %9s %9s %12s %9s %9s\n", "R", "W", "hubs",
+           "reads/sec", "read p99", "p99.9", "writes/sec", "write p99",
+           "p99.9");
+    for (BenchResult& pt : points) {
+        double reads = pt.extra["incoming_set_ops_per_sec"] +
+                       pt.extra["incoming_set_size_ops_per_sec"];
+        printf("%4.0f %4.0f %6.0f %12.0f %9.0f %9.0f %12.0f %9.0f %9.0f\n",
+               pt.extra["readers"], pt.extra["writers"], pt.extra["hubs"],
+               reads, pt.latency.p99, pt.latency.p999,
+               pt.extra["add_link_ops_per_sec"], pt.extra["add_link_p99_ns"],
+               pt.extra["add_link_p999_ns"]);
+    }
+    cout << DIVIDER_LINE << endl;
+}
+
+// Parse the overlap percentages for the duplicate insertion benchmark.
+bool AtomSpaceBenchmark::setDupOverlaps(const std::string& spec)
+{
+    dupOverlaps.clear();
+    std::istringstream iss(spec);
+    std::string item;
+    while (std::getline(iss, item, ','))
+    {
+        char* end;
+        long pct = strtol(item.c_str(), &end, 10);
+        if (item.empty() or *end or pct < 0 or 100 < pct)
+        {
+            cerr << "Error: bad overlap percentage: " << item << endl;
+            return false;
+        }
+        dupOverlaps.push_back(pct);
+    }
+    return not dupOverlaps.empty();
+}
+
+// Each of numThreads threads inserts its own list of EvaluationLinks,
+// (Evaluation dup-predicate (List (Concept "dup-...")))), all as nodes
+// and links that might or might not be there yet. Item j of every list
+// is the same atom on all threads if j % 100 < overlap, and private to
+// the thread otherwise; as the threads go through their lists in the
+// same order, they try to insert the shared atoms at the same time.
+// Afterwards, check that the atomspace grew by exactly the number of
+// distinct atoms, and that all threads got the same shared atoms back.
+BenchResult AtomSpaceBenchmark::doDupInsert(int overlap, int numThreads,
+                                            bool& ok)
+{
+    size_t perThread = std::max(1u, baseNreps / numThreads);
+    cout << "Duplicate insertion, " << overlap << "% overlap: "
+         << perThread << " EvaluationLinks on each of " << numThreads
+         << " thread(s) " << flush;
+
+    Handle pred = addGraphAtom(PREDICATE_NODE, "dup-predicate");
+    size_t before = (testKind == BENCH_TABLE) ?
+                    atab->getSize() : asp->get_size();
+
+    size_t shared = 0;
+    for (size_t j = 0; j < perThread; j++)
+        if ((int) (j % 100) < overlap) shared++;
+
+    std::vector<std::vector<std::string>> names(numThreads);
+    std::vector<HandleSeq> got(numThreads);
+    std::vector<LatencyHistogram> latency(numThreads);
+    std::vector<uint64_t> busy(numThreads);
+    std::atomic<int> ready(0);
+    std::atomic<bool> go(false);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < numThreads; t++) {
+        threads.emplace_back([&, t]() {
+            std::vector<std::string>& nm = names[t];
+            for (size_t j = 0; j < perThread; j++)
+                nm.push_back((int) (j % 100) < overlap ?
+                    "dup-" + std::to_string(j) :
+                    "dup-" + std::to_string(t) + "-" + std::to_string(j));
+            got[t].resize(perThread);
+            ready++;
+            while (not go) std::this_thread::yield();
+            if (profiler) SampleProfiler::resume();
+            uint64_t t_begin = monotonic_ns();
+            for (size_t j = 0; j < perThread; j++)
+            {
+                uint64_t op_begin = monotonic_ns();
+                Handle n = addGraphAtom(CONCEPT_NODE, std::move(nm[j]));
+                Handle l = addGraphAtom(LIST_LINK, HandleSeq({n}));
+                got[t][j] = addGraphAtom(EVALUATION_LINK,
+                                         HandleSeq({pred, l}));
+                latency[t].record(monotonic_ns() - op_begin);
+            }
+            busy[t] = monotonic_ns() - t_begin;
+            if (profiler) SampleProfiler::pause();
+        });
+    }
+    while (ready < numThreads) std::this_thread::yield();
+    uint64_t t0 = monotonic_ns();
+    go = true;
+    for (std::thread& th : threads) th.join();
+    uint64_t t1 = monotonic_ns();
+
+    size_t after = (testKind == BENCH_TABLE) ?
+                   atab->getSize() : asp->get_size();
+    // A node, a ListLink and an EvaluationLink per distinct item.
+    size_t expected = 3 * (shared + numThreads * (perThread - shared));
+    size_t mismatches = 0;
+    for (int t = 1; t < numThreads; t++)
+        for (size_t j = 0; j < perThread; j++)
+            if ((int) (j % 100) < overlap and got[t][j] != got[0][j])
+                mismatches++;
+    ok = (after - before == expected) and 0 == mismatches;
+
+    LatencyHistogram merged;
+    for (const LatencyHistogram& lh : latency) merged.merge(lh);
+
+    BenchResult res;
+    res.method = "dup-insert:" + std::to_string(overlap);
+    res.api = apiName();
+    res.threads = numThreads;
+    res.ops = perThread * numThreads;
+    res.wallSeconds = (t1 - t0) / 1.0e9;
+    res.opsPerSec = res.ops / res.wallSeconds;
+    res.samples.push_back(res.opsPerSec);
+    res.extra["overlap_pct"] = overlap;
+    res.extra["expected_atoms"] = expected;
+    res.extra["added_atoms"] = after - before;
+    res.extra["handle_mismatches"] = mismatches;
+    res.extra["atom_count_ok"] = ok;
+    addLatency(res, merged);
+
+    printf("\n%.6lf seconds elapsed, %.2f insertions per second\n",
+           res.wallSeconds, res.opsPerSec);
+    printf("Atoms added: %lu, expected %lu; %lu shared atoms differ"
+           " between threads%s\n", (unsigned long) (after - before),
+           (unsigned long) expected, (unsigned long) mismatches,
+           ok ? "" : " -- DEDUPLICATION FAILED");
+    printf("%8s %14s %10s %10s %10s %12s\n", "thread", "per second",
+           "p50", "p99", "p99.9", "max");
+    for (int t = 0; t < numThreads; t++) {
+        const LatencyHistogram& lh = latency[t];
+        double rate = 1.0e9 * perThread / busy[t];
+        std::string key = "thread" + std::to_string(t);
+        res.extra[key + "_ops_per_sec"] = rate;
+        res.extra[key + "_p99_ns"] = lh.percentile(99.0);
+        printf("%8d %14.0f %10lu %10lu %10lu %12lu\n", t, rate,
+               (unsigned long) lh.percentile(50.0),
+               (unsigned long) lh.percentile(99.0),
+               (unsigned long) lh.percentile(99.9),
+               (unsigned long) lh.max());
+    }
+    printLatency(merged);
+    cout << DIVIDER_LINE << endl;
+    return res;
+}
+
+// Every overlap, on a freshly built atomspace each. Returns the number
+// of runs whose atom count or handles were wrong.
+int AtomSpaceBenchmark::runDupInsert(int numThreads)
+{
+    std::vector<BenchResult> points;
+    int failures = 0;
+    for (int overlap : dupOverlaps) {
+        bool ok;
+        setupAtomSpace();
+        if (profiler) profiler->start();
+        points.push_back(doDupInsert(overlap, numThreads, ok));
+        if (profiler) profiler->stop(points.back().method);
+        teardownAtomSpace();
+        recordResult(points.back());
+        if (not ok) failures++;
+    }
+
+    cout << "Duplicate insertion on " << numThreads
+         << " thread(s) (latencies in nanoseconds):" << endl;
+    printf("%8s %14s %10s %10s %10s %12s %6s\n", "overlap", "inserts/sec",
+           "p50", "p99", "p99.9", "atoms added", "check");
+    for (BenchResult& pt : points)
+        printf("%7.0f%% %14.0f %10.0f %10.0f %10.0f %12.0f %6s\n",
+               pt.extra["overlap_pct"], pt.opsPerSec, pt.latency.p50,
+               pt.latency.p99, pt.latency.p999, pt.extra["added_atoms"],
+               pt.extra["atom_count_ok"] ? "ok" : "FAILED");
+    cout << DIVIDER_LINE << endl;
+    return failures;
 }
 
 std::string
@@ -652,16 +2521,16 @@ clock_t AtomSpaceBenchmark::makeRandomNodes(const std::string& csi)
 
     switch (testKind) {
     case BENCH_TABLE: {
-        clock_t t_begin = clock();
+        clock_t t_begin = timerStart();
         for (unsigned int i=0; i<Nclock; i++)
-            atab->add(createNode(ta[i], std::move(nn[i])), false);
-        return clock() - t_begin;
+            TIMED_OP(atab->add(createNode(ta[i], std::move(nn[i])), false));
+        return timerStop(t_begin);
     }
     case BENCH_AS: {
-        clock_t t_begin = clock();
+        clock_t t_begin = timerStart();
         for (unsigned int i=0; i<Nclock; i++)
-            asp->add_node(ta[i], std::move(nn[i]));
-        return clock() - t_begin;
+            TIMED_OP(asp->add_node(ta[i], std::move(nn[i])));
+        return timerStop(t_begin);
     }
 #if HAVE_GUILE
     case BENCH_SCM: {
@@ -684,10 +2553,10 @@ clock_t AtomSpaceBenchmark::makeRandomNodes(const std::string& csi)
             gsa[i] = gs;
         }
 
-        clock_t t_begin = clock();
+        clock_t t_begin = timerStart();
         for (unsigned int i=0; i<Nclock; i++)
-            scm->eval_h(gsa[i]);
-        return clock() - t_begin;
+            TIMED_OP(scm->eval_h(gsa[i]));
+        return timerStop(t_begin);
     }
 #endif /* HAVE_GUILE */
 
@@ -711,10 +2580,10 @@ clock_t AtomSpaceBenchmark::makeRandomNodes(const std::string& csi)
             std::string ps = memoize_or_compile(lbl, dss.str());
             psa[i] = ps;
         }
-        clock_t t_begin = clock();
+        clock_t t_begin = timerStart();
         for (unsigned int i = 0; i < Nclock; ++i)
-            pyev->eval(psa[i]);
-        return clock() - t_begin;
+            TIMED_OP(pyev->eval(psa[i]));
+        return timerStop(t_begin);
     }
 #endif /* HAVE_CYTHON */
     }
@@ -733,8 +2602,7 @@ clock_t AtomSpaceBenchmark::makeRandomLinks()
         if (p < chanceOfNonDefaultLink) t = randomType(LINK);
         ta[i] = t;
 
-        size_t arity = (*poissonDistribution)(*randomGenerator);
-        if (arity == 0) { ++arity; };
+        size_t arity = randomArity();
 
         // AtomSpace will throw if the context link has bad arity
         if (CONTEXT_LINK == t) arity = 2;
@@ -768,10 +2636,10 @@ clock_t AtomSpaceBenchmark::makeRandomLinks()
             std::string ps = dss.str();
             psa[i] = ps;
         }
-        clock_t t_begin = clock();
+        clock_t t_begin = timerStart();
         for (unsigned int i=0; i<Nclock; i++)
-            pyev->eval(psa[i]);
-        return clock() - t_begin;
+            TIMED_OP(pyev->eval(psa[i]));
+        return timerStop(t_begin);
     }
 #endif /* HAVE_CYTHON */
 
@@ -805,23 +2673,23 @@ clock_t AtomSpaceBenchmark::makeRandomLinks()
             gsa[i] = gs;
         }
 
-        clock_t t_begin = clock();
+        clock_t t_begin = timerStart();
         for (unsigned int i=0; i<Nclock; i++)
-            scm->eval_h(gsa[i]);
-        return clock() - t_begin;
+            TIMED_OP(scm->eval_h(gsa[i]));
+        return timerStop(t_begin);
     }
 #endif /* HAVE_GUILE */
     case BENCH_TABLE: {
-        clock_t tAddLinkStart = clock();
+        clock_t tAddLinkStart = timerStart();
         for (unsigned int i=0; i<Nclock; i++)
-            atab->add(createLink(std::move(og[i]), ta[i]), false);
-        return clock() - tAddLinkStart;
+            TIMED_OP(atab->add(createLink(std::move(og[i]), ta[i]), false));
+        return timerStop(tAddLinkStart);
     }
     case BENCH_AS: {
-        clock_t tAddLinkStart = clock();
+        clock_t tAddLinkStart = timerStart();
         for (unsigned int i=0; i<Nclock; i++)
-            asp->add_link(ta[i], std::move(og[i]));
-        return clock() - tAddLinkStart;
+            TIMED_OP(asp->add_link(ta[i], std::move(og[i])));
+        return timerStop(tAddLinkStart);
     }}
     return 0;
 }
@@ -830,6 +2698,13 @@ void AtomSpaceBenchmark::buildAtomSpace(long atomspaceSize,
                                         float _percentLinks, bool display)
 {
     BenchType saveKind = testKind;
+    // Atoms added here are not part of any measurement.
+    LatencyHistogram* saveHist = latencyHist;
+    latencyHist = NULL;
+    PerfCounters* saveCounters = perfCounters;
+    perfCounters = NULL;
+    SampleProfiler* saveProfiler = profiler;
+    profiler = NULL;
 #if HAVE_CYTHON
     if (testKind == BENCH_PYTHON)
        testKind = BENCH_AS;
@@ -890,6 +2765,396 @@ void AtomSpaceBenchmark::buildAtomSpace(long atomspaceSize,
 
     UUID_end = tlbuf.size() + UUID_PAD;
     testKind = saveKind;
+    latencyHist = saveHist;
+    perfCounters = saveCounters;
+    profiler = saveProfiler;
+}
+
+// The serial builder works in chunks of 5000 atoms, and so gets the
+// size badly wrong for small atomspaces; a size sweep needs the sizes
+// to be exact, and so always uses the parallel one. The other graph
+// shapes have their own (serial, exact) builder.
+bool AtomSpaceBenchmark::parallelBuild() const
+{
+    if (GraphShape::UNIFORM != graphShape.kind()) return false;
+    return 1 < buildThreads or not sweepSizes.empty();
+}
+
+// Build the test atomspace, on buildThreads threads if asked to.
+// Returns the seconds taken.
+double AtomSpaceBenchmark::generateAtomSpace()
+{
+    uint64_t t1 = monotonic_ns();
+    if (GraphShape::UNIFORM != graphShape.kind())
+        buildGraph(atomCount, percentLinks);
+    else if (parallelBuild())
+        buildAtomSpaceParallel(atomCount, percentLinks, buildThreads);
+    else
+        buildAtomSpace(atomCount, percentLinks, false);
+    return (monotonic_ns() - t1) / 1.0e9;
+}
+
+// Parallel version of buildAtomSpace(). Each of numThreads workers
+// makes and inserts its own share of the nodes, and then of the links,
+// using its own random generator and its own range of node names. The
+// links only point at the nodes, picked from all of them. Which atoms
+// get made depends only on the seed and on numThreads; only the order
+// of insertion varies from run to run, and the TLB is filled in worker
+// order afterwards.
+void AtomSpaceBenchmark::buildAtomSpaceParallel(long atomspaceSize,
+                                                float _percentLinks,
+                                                int numThreads)
+{
+    // As in makeRandomNodes(), non-default types come in chunks.
+    const long CHUNK = 5000;
+    long nodeCount = atomspaceSize * (1.0f - _percentLinks);
+    long linkCount = atomspaceSize - nodeCount;
+    long base = counter;
+
+    std::vector<AtomSpaceBenchmark*> workers;
+    for (int t = 0; t < numThreads; t++) {
+        AtomSpaceBenchmark* w = makeWorker(t, numThreads);
+        delete w->randomGenerator;
+        w->randomGenerator = new opencog::MT19937RandGen(
+            randomseed * 6364136223846793005UL + 1442695040888963407UL * (t + 1));
+        workers.push_back(w);
+    }
+
+    auto add = [&](Type t, std::string&& name) {
+        return (testKind == BENCH_TABLE) ?
+            atab->add(createNode(t, std::move(name)), false) :
+            asp->add_node(t, std::move(name));
+    };
+    auto addl = [&](Type t, HandleSeq&& oset) {
+        return (testKind == BENCH_TABLE) ?
+            atab->add(createLink(std::move(oset), t), false) :
+            asp->add_link(t, std::move(oset));
+    };
+
+    std::vector<HandleSeq> nodes(numThreads);
+    std::vector<HandleSeq> links(numThreads);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < numThreads; t++) {
+        threads.emplace_back([&, t]() {
+            AtomSpaceBenchmark* w = workers[t];
+            long begin = nodeCount * t / numThreads;
+            long end = nodeCount * (t + 1) / numThreads;
+            nodes[t].reserve(end - begin);
+            bool nonDefault = false;
+            for (long i = begin; i < end; i++) {
+                if (0 == (i - begin) % CHUNK)
+                    nonDefault = (w->randomGenerator->randdouble()
+                                  < chanceOfNonDefaultNode);
+                Type nt = nonDefault ? w->randomType(NODE) : defaultNodeType;
+                std::string name = std::to_string(base + i + 1);
+                if (NUMBER_NODE != nt) name = "node " + name;
+                nodes[t].push_back(add(nt, std::move(name)));
+            }
+        });
+    }
+    for (std::thread& th : threads) th.join();
+    threads.clear();
+
+    HandleSeq allNodes;
+    allNodes.reserve(nodeCount);
+    for (HandleSeq& hs : nodes)
+        allNodes.insert(allNodes.end(), hs.begin(), hs.end());
+    if (allNodes.empty()) linkCount = 0;
+
+    for (int t = 0; t < numThreads; t++) {
+        threads.emplace_back([&, t]() {
+            AtomSpaceBenchmark* w = workers[t];
+            long begin = linkCount * t / numThreads;
+            long end = linkCount * (t + 1) / numThreads;
+            links[t].reserve(end - begin);
+            bool nonDefault = false;
+            for (long i = begin; i < end; i++) {
+                if (0 == (i - begin) % CHUNK)
+                    nonDefault = (w->randomGenerator->randdouble()
+                                  < chanceOfNonDefaultLink);
+                Type lt = nonDefault ? w->randomType(LINK) : defaultLinkType;
+                size_t arity = w->randomArity();
+                if (CONTEXT_LINK == lt) arity = 2;
+                HandleSeq oset;
+                for (size_t j = 0; j < arity; j++)
+                    oset.push_back(allNodes[
+                        w->randomGenerator->randint(allNodes.size())]);
+                links[t].push_back(addl(lt, std::move(oset)));
+            }
+        });
+    }
+    for (std::thread& th : threads) th.join();
+
+    for (const Handle& h : allNodes)
+        tlbuf.addAtom(h, TLB::INVALID_UUID);
+    for (HandleSeq& hs : links)
+        for (const Handle& h : hs)
+            tlbuf.addAtom(h, TLB::INVALID_UUID);
+    UUID_end = tlbuf.size() + UUID_PAD;
+    counter = base + nodeCount;
+
+    for (AtomSpaceBenchmark* w : workers) delete w;
+}
+
+// Parse the sizes for --size-sweep: "from:to" or "from:to:factor",
+// where each number may also be given as a power of two, e.g. 2^20.
+bool AtomSpaceBenchmark::setSizes(const std::string& spec)
+{
+    std::vector<double> val;
+    std::istringstream iss(spec);
+    std::string item;
+    while (std::getline(iss, item, ':'))
+    {
+        size_t caret = item.find('^');
+        if (caret == std::string::npos)
+            val.push_back(atof(item.c_str()));
+        else
+            val.push_back(pow(atof(item.substr(0, caret).c_str()),
+                              atof(item.substr(caret + 1).c_str())));
+    }
+    if (val.size() == 2) val.push_back(2.0);
+    if (val.size() != 3 or val[0] < 1.0 or val[1] < val[0] or val[2] <= 1.0)
+    {
+        cerr << "Error: bad size sweep: " << spec << endl;
+        return false;
+    }
+    sweepSizes.clear();
+    for (double sz = val[0]; sz <= val[1] * 1.000001; sz *= val[2])
+        sweepSizes.push_back((long) (sz + 0.5));
+    return true;
+}
+
+// Run the selected methods on atomspaces of each of the sweep sizes,
+// with the same settings, and print a row of ops/sec per size.
+void AtomSpaceBenchmark::runSizeSweep(int numThreads)
+{
+    long saveCount = atomCount;
+    std::vector<std::vector<double>> rows;
+    for (long size : sweepSizes) {
+        atomCount = size;
+        runInfo.atomCount = size;
+        cout << "Atomspace size " << size << endl;
+        std::vector<double> row;
+        for (unsigned int i = 0; i < methodNames.size(); i++) {
+            BenchResult res =
+                repeatBenchmark(methodNames[i], methodsToTest[i], numThreads);
+            res.extra["atom_count"] = size;
+            recordResult(res);
+            row.push_back(res.opsPerSec);
+        }
+        rows.push_back(row);
+    }
+    atomCount = saveCount;
+    runInfo.atomCount = saveCount;
+
+    cout << "Ops/sec against atomspace size";
+    if (1 < numThreads) cout << ", on " << numThreads << " threads";
+    cout << ":" << endl;
+    printf("%12s", "atoms");
+    for (const std::string& name : methodNames)
+        printf(" %14.14s", name.c_str());
+    printf("\n");
+    for (size_t r = 0; r < rows.size(); r++) {
+        printf("%12ld", sweepSizes[r]);
+        for (double rate : rows[r]) printf(" %14.0f", rate);
+        printf("\n");
+    }
+    cout << DIVIDER_LINE << endl;
+}
+
+size_t AtomSpaceBenchmark::randomArity()
+{
+    if (ArityDistribution::POISSON != arity.kind())
+        return arity.sample(*randomGenerator);
+    size_t a = (*poissonDistribution)(*randomGenerator);
+    return (0 == a) ? 1 : a;
+}
+
+Handle AtomSpaceBenchmark::addGraphAtom(Type t, std::string&& name)
+{
+    if (testKind == BENCH_TABLE)
+        return atab->add(createNode(t, std::move(name)), false);
+    return asp->add_node(t, std::move(name));
+}
+
+Handle AtomSpaceBenchmark::addGraphAtom(Type t, HandleSeq&& oset)
+{
+    if (testKind == BENCH_TABLE)
+        return atab->add(createLink(std::move(oset), t), false);
+    return asp->add_link(t, std::move(oset));
+}
+
+// Build a test atomspace of exactly atomspaceSize atoms, with the
+// links shaped by graphShape (see GraphShape.h). Node and link types
+// are picked as in buildAtomSpace().
+void AtomSpaceBenchmark::buildGraph(long atomspaceSize, float _percentLinks)
+{
+    const long CHUNK = 5000;
+    HandleSeq nodes;
+    HandleSeq links;
+
+    if (GraphShape::ZIPF_PAIRS == graphShape.kind()) {
+        buildZipfPairs(atomspaceSize, nodes, links);
+    }
+    else {
+        long nodeCount = std::max(1L,
+            (long) (atomspaceSize * (1.0f - _percentLinks)));
+        long linkCount = atomspaceSize - nodeCount;
+        double linksPerNode = (double) linkCount / nodeCount;
+        nodes.reserve(nodeCount);
+        links.reserve(linkCount);
+
+        // Endpoints of all links so far, one entry per incidence: a
+        // uniform pick from it is a pick proportional to degree.
+        HandleSeq ends;
+        double owed = 0.0;
+        bool nonDefaultNode = false;
+        bool nonDefaultLink = false;
+        auto linkType = [&]() {
+            if (0 == links.size() % CHUNK)
+                nonDefaultLink = (randomGenerator->randdouble()
+                                  < chanceOfNonDefaultLink);
+            return nonDefaultLink ? randomType(LINK) : defaultLinkType;
+        };
+        auto linkArity = [&](Type t) {
+            // AtomSpace will throw if the context link has bad arity
+            return (CONTEXT_LINK == t) ? 2 : randomArity();
+        };
+
+        for (long i = 0; i < nodeCount; i++) {
+            if (0 == i % CHUNK)
+                nonDefaultNode = (randomGenerator->randdouble()
+                                  < chanceOfNonDefaultNode);
+            Type nt = nonDefaultNode ? randomType(NODE) : defaultNodeType;
+            counter++;
+            std::string name = std::to_string(counter);
+            if (NUMBER_NODE != nt) name = "node " + name;
+            nodes.push_back(addGraphAtom(nt, std::move(name)));
+            if (GraphShape::BARABASI_ALBERT != graphShape.kind()) continue;
+
+            // The new node links to older ones, by degree plus one.
+            owed += linksPerNode;
+            while (1.0 <= owed and 1 < nodes.size()) {
+                Type lt = linkType();
+                size_t ar = linkArity(lt);
+                HandleSeq oset;
+                oset.push_back(nodes.back());
+                size_t older = nodes.size() - 1;
+                while (oset.size() < ar) {
+                    size_t pick = randomGenerator->randint(older + ends.size());
+                    oset.push_back(pick < older ? nodes[pick]
+                                                : ends[pick - older]);
+                }
+                ends.insert(ends.end(), oset.begin(), oset.end());
+                links.push_back(addGraphAtom(lt, std::move(oset)));
+                owed -= 1.0;
+            }
+        }
+
+        if (GraphShape::RMAT == graphShape.kind()) {
+            for (long i = 0; i < linkCount; i++) {
+                Type lt = linkType();
+                size_t ar = linkArity(lt);
+                HandleSeq oset;
+                std::pair<size_t, size_t> e =
+                    graphShape.rmatEdge(*randomGenerator, nodes.size());
+                oset.push_back(nodes[e.first]);
+                while (oset.size() < ar) {
+                    oset.push_back(nodes[e.second]);
+                    e = graphShape.rmatEdge(*randomGenerator, nodes.size());
+                }
+                links.push_back(addGraphAtom(lt, std::move(oset)));
+            }
+        }
+    }
+
+    for (const Handle& h : nodes)
+        tlbuf.addAtom(h, TLB::INVALID_UUID);
+    for (const Handle& h : links)
+        tlbuf.addAtom(h, TLB::INVALID_UUID);
+    UUID_end = tlbuf.size() + UUID_PAD;
+}
+
+// The word-pair model of micro/large_zipf_bm.cc: ListLinks of pairs
+// of words, where half of the words are in one pair, a quarter in two,
+// an eighth in four, and so on. Keeps adding pairs, and new words as
+// needed, until there are atomspaceSize atoms.
+void AtomSpaceBenchmark::buildZipfPairs(long atomspaceSize,
+                                        HandleSeq& words, HandleSeq& pairs)
+{
+    std::string wrdbase = "Word-ishy ";
+    auto addWord = [&]() {
+        counter++;
+        Handle hw = addGraphAtom(CONCEPT_NODE,
+                                 wrdbase + std::to_string(counter));
+        hw->setTruthValue(CountTruthValue::createTV(1, 0, 0));
+        words.push_back(hw);
+    };
+
+    addWord();
+    size_t w1 = 0, w2 = 0, wmax = 1;
+    while ((long) (words.size() + pairs.size()) < atomspaceSize) {
+        Handle hpair = addGraphAtom(LIST_LINK,
+                                    HandleSeq({words[w1], words[w2]}));
+        hpair->setTruthValue(CountTruthValue::createTV(1, 0, 1));
+        pairs.push_back(hpair);
+
+        w2++;
+        if (wmax <= w2) {
+            w2 = 0;
+            w1++;
+            if (words.size() <= w1) {
+                addWord();
+                w1 = 0;
+            }
+            wmax = words.size() / (w1 + 1);
+        }
+    }
+}
+
+// Build the test atomspace on 1, 2, 4 ... buildThreads threads, each
+// time from scratch, and report the build rate and the speedup over
+// the serial builder.
+void AtomSpaceBenchmark::runBuildScaling()
+{
+    bool saveBuild = buildTestData;
+    int saveThreads = buildThreads;
+    buildTestData = false;
+
+    std::vector<BenchResult> scaling;
+    for (int nt = 1; ; nt = std::min(2*nt, saveThreads)) {
+        setupAtomSpace();
+        buildThreads = nt;
+        double secs = generateAtomSpace();
+        size_t size = (testKind == BENCH_TABLE ?
+                       atab->getSize() : asp->get_size());
+        teardownAtomSpace();
+
+        BenchResult res;
+        res.method = "buildAtomSpace";
+        res.api = apiName();
+        res.threads = nt;
+        res.ops = size;
+        res.wallSeconds = secs;
+        res.opsPerSec = size / secs;
+        res.samples.push_back(res.opsPerSec);
+        printf("Built %lu atoms on %d thread(s) in %.3f seconds "
+               "(%.0f atoms per second)\n",
+               (unsigned long) size, nt, secs, res.opsPerSec);
+        scaling.push_back(res);
+        recordResult(res);
+        if (nt == saveThreads) break;
+    }
+    buildTestData = saveBuild;
+    buildThreads = saveThreads;
+
+    cout << "Build scaling (one thread is the serial builder):" << endl;
+    printf("%8s %12s %14s %8s\n", "threads", "seconds", "atoms/sec",
+           "speedup");
+    for (BenchResult& sp : scaling)
+        printf("%8d %12.3f %14.0f %8.2f\n", sp.threads, sp.wallSeconds,
+               sp.opsPerSec, sp.opsPerSec / scaling[0].opsPerSec);
+    cout << DIVIDER_LINE << endl;
 }
 
 timepair_t AtomSpaceBenchmark::bm_noop()
@@ -901,12 +3166,12 @@ timepair_t AtomSpaceBenchmark::bm_noop()
         n[i] = randomGenerator->randint(42);
     }
 
-    clock_t t_begin = clock();
+    clock_t t_begin = timerStart();
     int sum=0;
     // prevent compiler optimizer from optimizing away the loop.
     for (unsigned int i=0; i<Nclock; i++)
-        sum += n[i];
-    clock_t time_taken = clock() - t_begin;
+        TIMED_OP(sum += n[i]);
+    clock_t time_taken = timerStop(t_begin);
     global += sum;
     return timepair_t(time_taken,0);
 }
@@ -928,8 +3193,11 @@ timepair_t AtomSpaceBenchmark::bm_rmAtom()
     Handle hs[Nclock];
     for (unsigned int i=0; i<Nclock; i++)
     {
-        Handle h = getRandomHandle();
-        while (true)
+        // The pool hands out each leaf once, so no need to check that
+        // it was not picked already.
+        Handle h;
+        if (leaves) h = leaves->take(*randomGenerator);
+        while (not leaves or not h)
         {
             h = getRandomHandle();
 
@@ -967,10 +3235,10 @@ timepair_t AtomSpaceBenchmark::bm_rmAtom()
             std::string ps = dss.str();
             psa[i] = ps;
         }
-        clock_t t_begin = clock();
+        clock_t t_begin = timerStart();
         for (unsigned int i=0; i<Nclock; i++)
-            pyev->eval(psa[i]);
-        clock_t time_taken = clock() - t_begin;
+            TIMED_OP(pyev->eval(psa[i]));
+        clock_t time_taken = timerStop(t_begin);
         return timepair_t(time_taken,0);
     }
 #endif /* HAVE_CYTHON */
@@ -1000,9 +3268,9 @@ timepair_t AtomSpaceBenchmark::bm_rmAtom()
             gsa[i] = gs;
         }
 
-        clock_t t_begin = clock();
+        clock_t t_begin = timerStart();
         for (unsigned int i=0; i<Nclock; i++) {
-            scm->eval(gsa[i]);
+            TIMED_OP(scm->eval(gsa[i]));
 #ifdef DONT_IGNORE_ERRORS
             // There's a good chance were trying to delete something
             // that doesn't exist any more...
@@ -1012,27 +3280,97 @@ timepair_t AtomSpaceBenchmark::bm_rmAtom()
             }
 #endif
         }
-        clock_t time_taken = clock() - t_begin;
+        clock_t time_taken = timerStop(t_begin);
         return timepair_t(time_taken,0);
     }
 #endif /* HAVE_GUILE */
     case BENCH_TABLE: {
-        clock_t t_begin = clock();
+        clock_t t_begin = timerStart();
         for (unsigned int i=0; i<Nclock; i++)
-            atab->extract(hs[i]);
-        clock_t time_taken = clock() - t_begin;
+            TIMED_OP(atab->extract(hs[i]));
+        clock_t time_taken = timerStop(t_begin);
+        if (leaves)
+            for (unsigned int i=0; i<Nclock; i++) leaves->removed(hs[i]);
         return timepair_t(time_taken,0);
     }
     case BENCH_AS: {
-        clock_t t_begin = clock();
+        clock_t t_begin = timerStart();
         for (unsigned int i=0; i<Nclock; i++)
-            asp->remove_atom(hs[i]);
-        clock_t time_taken = clock() - t_begin;
+            TIMED_OP(asp->remove_atom(hs[i]));
+        clock_t time_taken = timerStop(t_begin);
+        if (leaves)
+            for (unsigned int i=0; i<Nclock; i++) leaves->removed(hs[i]);
         return timepair_t(time_taken,0);
     }}
     return timepair_t(0,0);
 }
 
+// Atoms in each tree that bm_rmAtomRecursive() removes: the root and
+// fanout + fanout^2 + ... + fanout^depth links above it.
+size_t AtomSpaceBenchmark::removeTreeSize() const
+{
+    size_t size = 1, level = 1;
+    for (unsigned int d = 0; d < rmTreeDepth; d++) {
+        level *= rmTreeFanout;
+        size += level;
+    }
+    return size;
+}
+
+bool AtomSpaceBenchmark::setRemoveTree(const std::string& spec)
+{
+    unsigned int depth, fanout;
+    char end;
+    if (2 != sscanf(spec.c_str(), "%u:%u%c", &depth, &fanout, &end)
+        or depth < 1 or fanout < 1)
+    {
+        cerr << "Error: bad tree shape (<depth>:<fanout>): " << spec << endl;
+        return false;
+    }
+    rmTreeDepth = depth;
+    rmTreeFanout = fanout;
+    return true;
+}
+
+// Remove a node, and recursively everything in its incoming tree:
+// rmTreeFanout links with the node in their outgoing set, then as many
+// links above each of those, and so on, rmTreeDepth levels up. Every
+// link also holds a random atom of the test atomspace, so that the
+// removals also have to update the incoming sets of those.
+timepair_t AtomSpaceBenchmark::bm_rmAtomRecursive()
+{
+    if (testKind != BENCH_AS and testKind != BENCH_TABLE)
+        return timepair_t(0,0);
+
+    Handle roots[Nclock];
+    for (unsigned int i=0; i<Nclock; i++)
+    {
+        roots[i] = addGraphAtom(CONCEPT_NODE,
+                                "tree root " + std::to_string(++counter));
+        HandleSeq level({roots[i]});
+        for (unsigned int d = 0; d < rmTreeDepth; d++)
+        {
+            HandleSeq above;
+            for (const Handle& h : level)
+                for (unsigned int f = 0; f < rmTreeFanout; f++)
+                    above.push_back(addGraphAtom(LIST_LINK,
+                        HandleSeq({h, getRandomHandle()})));
+            level.swap(above);
+        }
+    }
+
+    clock_t t_begin = timerStart();
+    if (testKind == BENCH_TABLE) {
+        for (unsigned int i=0; i<Nclock; i++)
+            TIMED_OP(atab->extract(roots[i], true));
+    } else {
+        for (unsigned int i=0; i<Nclock; i++)
+            TIMED_OP(asp->remove_atom(roots[i], true));
+    }
+    clock_t time_taken = timerStop(t_begin);
+    return timepair_t(time_taken,0);
+}
+
 Handle AtomSpaceBenchmark::getRandomHandle()
 {
     UUID ranu = UUID_begin + randomGenerator->randint(UUID_end-1-UUID_begin);
@@ -1046,11 +3384,27 @@ Handle AtomSpaceBenchmark::getRandomHandle()
     return h;
 }
 
+// Like getRandomHandle(), but following the access pattern set with -D.
+// UUIDs are handed out in insertion order, so an index into the TLB is
+// an index into the insertion order.
+Handle AtomSpaceBenchmark::getReadHandle()
+{
+    if (AccessPattern::UNIFORM == accessPattern.kind())
+        return getRandomHandle();
+
+    // The atoms of this atomspace have UUIDs UUID_begin and up.
+    size_t n = UUID_end - UUID_PAD + 1 - UUID_begin;
+    Handle h;
+    while (NULL == h.operator->())
+        h = tlbuf.getAtom(UUID_begin + accessPattern.next(*randomGenerator, n));
+    return h;
+}
+
 timepair_t AtomSpaceBenchmark::bm_getType()
 {
     Handle hs[Nclock];
     for (unsigned int i=0; i<Nclock; i++)
-        hs[i] = getRandomHandle();
+        hs[i] = getReadHandle();
 
     switch (testKind) {
 #if HAVE_CYTHON
@@ -1062,15 +3416,15 @@ timepair_t AtomSpaceBenchmark::bm_getType()
             std::ostringstream dss;
             for (unsigned int i=0; i<Nloops; i++) {
                 dss << "type = Atom(" << &h << ", aspace)" << ".type\n";
-                h = getRandomHandle();
+                h = getReadHandle();
             }
             std::string ps = dss.str();
             psa[i] = ps;
         }
-        clock_t t_begin = clock();
+        clock_t t_begin = timerStart();
         for (unsigned int i=0; i<Nclock; i++)
-            pyev->eval(psa[i]);
-        clock_t time_taken = clock() - t_begin;
+            TIMED_OP(pyev->eval(psa[i]));
+        clock_t time_taken = timerStop(t_begin);
         return timepair_t(time_taken,0);
     }
 #endif /* HAVE_CYTHON */
@@ -1088,34 +3442,34 @@ timepair_t AtomSpaceBenchmark::bm_getType()
                 std::string bar = symb + std::to_string(i*Nloops + j);
                 guile_define(bar, h);
                 ss << "(cog-type " << bar << ")\n";
-                h = getRandomHandle();
+                h = getReadHandle();
             }
             std::string lbl = GUILE_FUNB;
             lbl += std::to_string(i);
             std::string gs = memoize_or_compile(lbl, ss.str());
             gsa[i] = gs;
         }
-        clock_t t_begin = clock();
+        clock_t t_begin = timerStart();
         for (unsigned int i=0; i<Nclock; i++) {
-            scm->eval(gsa[i]);
+            TIMED_OP(scm->eval(gsa[i]));
             if (scm->eval_error()) {
                 printf("Caught error while evaluating %s\n", gsa[i].c_str());
                 exit(1);
             }
         }
-        clock_t time_taken = clock() - t_begin;
+        clock_t time_taken = timerStop(t_begin);
         return timepair_t(time_taken,0);
     }
 #endif /* HAVE_GUILE */
 
     case BENCH_AS:
     case BENCH_TABLE: {
-        clock_t t_begin = clock();
+        clock_t t_begin = timerStart();
         // summing prevents the optimizer from optimizing away.
         int sum = 0;
         for (unsigned int i=0; i<Nclock; i++)
-            sum += hs[i]->get_type();
-        clock_t time_taken = clock() - t_begin;
+            TIMED_OP(sum += hs[i]->get_type());
+        clock_t time_taken = timerStop(t_begin);
         global += sum;
         return timepair_t(time_taken,0);
     }
@@ -1127,7 +3481,7 @@ timepair_t AtomSpaceBenchmark::bm_getTruthValue()
 {
     Handle hs[Nclock];
     for (unsigned int i=0; i<Nclock; i++)
-        hs[i] = getRandomHandle();
+        hs[i] = getReadHandle();
 
     switch (testKind) {
 #if HAVE_CYTHON
@@ -1142,10 +3496,10 @@ timepair_t AtomSpaceBenchmark::bm_getTruthValue()
             std::string ps = dss.str();
             psa[i] = ps;
         }
-        clock_t t_begin = clock();
+        clock_t t_begin = timerStart();
         for (unsigned int i=0; i<Nclock; i++)
-            pyev->eval(psa[i]);
-        clock_t time_taken = clock() - t_begin;
+            TIMED_OP(pyev->eval(psa[i]));
+        clock_t time_taken = timerStop(t_begin);
         return timepair_t(time_taken,0);
     }
 #endif /* HAVE_CYTHON */
@@ -1163,31 +3517,31 @@ timepair_t AtomSpaceBenchmark::bm_getTruthValue()
                 std::string bar = symb + std::to_string(i*Nloops + j);
                 guile_define(bar, h);
                 ss << "(cog-tv " << bar << ")\n";
-                h = getRandomHandle();
+                h = getReadHandle();
             }
             std::string lbl = GUILE_FUNB;
             lbl += std::to_string(i);
             std::string gs = memoize_or_compile(lbl, ss.str());
             gsa[i] = gs;
         }
-        clock_t t_begin = clock();
+        clock_t t_begin = timerStart();
         for (unsigned int i=0; i<Nclock; i++) {
-            scm->eval(gsa[i]);
+            TIMED_OP(scm->eval(gsa[i]));
             if (scm->eval_error()) {
                 printf("Caught error while evaluating %s\n", gsa[i].c_str());
                 exit(1);
             }
         }
-        clock_t time_taken = clock() - t_begin;
+        clock_t time_taken = timerStop(t_begin);
         return timepair_t(time_taken,0);
     }
 #endif /* HAVE_GUILE */
     case BENCH_AS:
     case BENCH_TABLE: {
-        clock_t t_begin = clock();
+        clock_t t_begin = timerStart();
         for (unsigned int i=0; i<Nclock; i++)
-            hs[i]->getTruthValue();
-        clock_t time_taken = clock() - t_begin;
+            TIMED_OP(hs[i]->getTruthValue());
+        clock_t time_taken = timerStop(t_begin);
         return timepair_t(time_taken,0);
     }
     }
@@ -1198,9 +3552,9 @@ timepair_t AtomSpaceBenchmark::bm_getTruthValue()
 timepair_t AtomSpaceBenchmark::bm_getTruthValueZmq()
 {
     Handle h = getRandomHandle();
-    clock_t t_begin = clock();
+    clock_t t_begin = timerStart();
     asp->getTVZmq(h);
-    return clock() - t_begin;
+    return timerStop(t_begin);
 }
 #endif
 
@@ -1232,10 +3586,10 @@ timepair_t AtomSpaceBenchmark::bm_setTruthValue()
             std::string ps = dss.str();
             psa[i] = ps;
         }
-        clock_t t_begin = clock();
+        clock_t t_begin = timerStart();
         for (unsigned int i=0; i<Nclock; i++)
-            pyev->eval(psa[i]);
-        clock_t time_taken = clock() - t_begin;
+            TIMED_OP(pyev->eval(psa[i]));
+        clock_t time_taken = timerStop(t_begin);
         return timepair_t(time_taken,0);
     }
 #endif /* HAVE_CYTHON */
@@ -1266,27 +3620,29 @@ timepair_t AtomSpaceBenchmark::bm_setTruthValue()
             std::string gs = memoize_or_compile(lbl, ss.str());
             gsa[i] = gs;
         }
-        clock_t t_begin = clock();
+        clock_t t_begin = timerStart();
         for (unsigned int i=0; i<Nclock; i++) {
-            scm->eval(gsa[i]);
+            TIMED_OP(scm->eval(gsa[i]));
             if (scm->eval_error()) {
                 printf("Caught error while evaluating %s\n", gsa[i].c_str());
                 exit(1);
             }
         }
-        clock_t time_taken = clock() - t_begin;
+        clock_t time_taken = timerStop(t_begin);
         return timepair_t(time_taken,0);
     }
 #endif /* HAVE_GUILE */
     case BENCH_AS:
     case BENCH_TABLE: {
-        clock_t t_begin = clock();
+        clock_t t_begin = timerStart();
         for (unsigned int i=0; i<Nclock; i++)
         {
-            TruthValuePtr stv(SimpleTruthValue::createTV(strg[i], conf[i]));
-            hs[i]->setTruthValue(stv);
+            TIMED_OP(
+                TruthValuePtr stv(SimpleTruthValue::createTV(strg[i], conf[i]));
+                hs[i]->setTruthValue(stv);
+            );
         }
-        clock_t time_taken = clock() - t_begin;
+        clock_t time_taken = timerStop(t_begin);
         return timepair_t(time_taken,0);
     }
     }
@@ -1297,7 +3653,7 @@ timepair_t AtomSpaceBenchmark::bm_getIncomingSet()
 {
     Handle hs[Nclock];
     for (unsigned int i=0; i<Nclock; i++)
-        hs[i] = getRandomHandle();
+        hs[i] = getReadHandle();
 
     switch (testKind) {
 #if HAVE_CYTHON
@@ -1312,10 +3668,10 @@ timepair_t AtomSpaceBenchmark::bm_getIncomingSet()
             std::string ps = dss.str();
             psa[i] = ps;
         }
-        clock_t t_begin = clock();
+        clock_t t_begin = timerStart();
         for (unsigned int i=0; i<Nclock; i++)
-            pyev->eval(psa[i]);
-        clock_t time_taken = clock() - t_begin;
+            TIMED_OP(pyev->eval(psa[i]));
+        clock_t time_taken = timerStop(t_begin);
         return timepair_t(time_taken,0);
     }
 #endif /* HAVE_CYTHON */
@@ -1333,31 +3689,31 @@ timepair_t AtomSpaceBenchmark::bm_getIncomingSet()
                 std::string bar = symb + std::to_string(i*Nloops + j);
                 guile_define(bar, h);
                 ss << "(cog-incoming-set " << bar << ")\n";
-                h = getRandomHandle();
+                h = getReadHandle();
             }
             std::string lbl = GUILE_FUNB;
             lbl += std::to_string(i);
             std::string gs = memoize_or_compile(lbl, ss.str());
             gsa[i] = gs;
         }
-        clock_t t_begin = clock();
+        clock_t t_begin = timerStart();
         for (unsigned int i=0; i<Nclock; i++) {
-            scm->eval(gsa[i]);
+            TIMED_OP(scm->eval(gsa[i]));
             if (scm->eval_error()) {
                 printf("Caught error while evaluating %s\n", gsa[i].c_str());
                 exit(1);
             }
         }
-        clock_t time_taken = clock() - t_begin;
+        clock_t time_taken = timerStop(t_begin);
         return timepair_t(time_taken,0);
     }
 #endif /* HAVE_GUILE */
     case BENCH_AS:
     case BENCH_TABLE: {
-        clock_t t_begin = clock();
+        clock_t t_begin = timerStart();
         for (unsigned int i=0; i<Nclock; i++)
-            hs[i]->getIncomingSet();
-        clock_t time_taken = clock() - t_begin;
+            TIMED_OP(hs[i]->getIncomingSet());
+        clock_t time_taken = timerStop(t_begin);
         return timepair_t(time_taken,0);
     }
     }
@@ -1368,7 +3724,7 @@ timepair_t AtomSpaceBenchmark::bm_getIncomingSetSize()
 {
     Handle hs[Nclock];
     for (unsigned int i=0; i<Nclock; i++)
-        hs[i] = getRandomHandle();
+        hs[i] = getReadHandle();
 
     switch (testKind) {
 #if HAVE_CYTHON
@@ -1383,10 +3739,10 @@ timepair_t AtomSpaceBenchmark::bm_getIncomingSetSize()
 #endif /* HAVE_GUILE */
     case BENCH_AS:
     case BENCH_TABLE: {
-        clock_t t_begin = clock();
+        clock_t t_begin = timerStart();
         for (unsigned int i=0; i<Nclock; i++)
-            hs[i]->getIncomingSetSize();
-        clock_t time_taken = clock() - t_begin;
+            TIMED_OP(hs[i]->getIncomingSetSize());
+        clock_t time_taken = timerStop(t_begin);
         return timepair_t(time_taken,0);
     }
     }
@@ -1398,7 +3754,7 @@ timepair_t AtomSpaceBenchmark::bm_pointerCast()
 {
     Handle hs[Nclock];
     for (unsigned int i=0; i<Nclock; i++)
-        hs[i] = getRandomHandle();
+        hs[i] = getReadHandle();
 
     switch (testKind) {
 #if HAVE_CYTHON
@@ -1420,21 +3776,25 @@ timepair_t AtomSpaceBenchmark::bm_pointerCast()
         // get_type() is very fast -- a method call, so we treat that as
         // a kind-of no-op.
         int sum = 0;
-        clock_t t_begin = clock();
+        clock_t t_begin = timerStart();
         for (unsigned int i=0; i<Nclock; i++)
         {
 #define MEASURE_LINKS
 #ifdef MEASURE_LINKS
-            LinkPtr l(LinkCast(hs[i]));
-            if (l)
-               sum += l->get_type();
+            TIMED_OP(
+                LinkPtr l(LinkCast(hs[i]));
+                if (l)
+                   sum += l->get_type();
+            );
 #else
-            NodePtr n(NodeCast(hs[i]));
-            if (n)
-               sum += n->get_type();
+            TIMED_OP(
+                NodePtr n(NodeCast(hs[i]));
+                if (n)
+                   sum += n->get_type();
+            );
 #endif
         }
-        clock_t time_taken = clock() - t_begin;
+        clock_t time_taken = timerStop(t_begin);
         global += sum;
         return timepair_t(time_taken,0);
     }
@@ -1446,7 +3806,7 @@ timepair_t AtomSpaceBenchmark::bm_getOutgoingSet()
 {
     Handle hs[Nclock];
     for (unsigned int i=0; i<Nclock; i++)
-        hs[i] = getRandomHandle();
+        hs[i] = getReadHandle();
 
     switch (testKind) {
 #if HAVE_CYTHON
@@ -1461,10 +3821,10 @@ timepair_t AtomSpaceBenchmark::bm_getOutgoingSet()
             std::string ps = dss.str();
             psa[i] = ps;
         }
-        clock_t t_begin = clock();
+        clock_t t_begin = timerStart();
         for (unsigned int i=0; i<Nclock; i++)
-            pyev->eval(psa[i]);
-        clock_t time_taken = clock() - t_begin;
+            TIMED_OP(pyev->eval(psa[i]));
+        clock_t time_taken = timerStop(t_begin);
         return timepair_t(time_taken,0);
     }
 #endif /* HAVE_CYTHON */
@@ -1482,34 +3842,36 @@ timepair_t AtomSpaceBenchmark::bm_getOutgoingSet()
                 std::string bar = symb + std::to_string(i*Nloops + j);
                 guile_define(bar, h);
                 ss << "(cog-outgoing-set " << bar << ")\n";
-                h = getRandomHandle();
+                h = getReadHandle();
             }
             std::string lbl = GUILE_FUNB;
             lbl += std::to_string(i);
             std::string gs = memoize_or_compile(lbl, ss.str());
             gsa[i] = gs;
         }
-        clock_t t_begin = clock();
+        clock_t t_begin = timerStart();
         for (unsigned int i=0; i<Nclock; i++) {
-            scm->eval(gsa[i]);
+            TIMED_OP(scm->eval(gsa[i]));
             if (scm->eval_error()) {
                 printf("Caught error while evaluating %s\n", gsa[i].c_str());
                 exit(1);
             }
         }
-        clock_t time_taken = clock() - t_begin;
+        clock_t time_taken = timerStop(t_begin);
         return timepair_t(time_taken,0);
     }
 #endif /* HAVE_GUILE */
     case BENCH_AS:
     case BENCH_TABLE: {
-        clock_t t_begin = clock();
+        clock_t t_begin = timerStart();
         for (unsigned int i=0; i<Nclock; i++)
         {
-            if (hs[i]->is_link())
-                hs[i]->getOutgoingSet();
+            TIMED_OP(
+                if (hs[i]->is_link())
+                    hs[i]->getOutgoingSet();
+            );
         }
-        clock_t time_taken = clock() - t_begin;
+        clock_t time_taken = timerStop(t_begin);
         return timepair_t(time_taken,0);
     }
     }
@@ -1526,9 +3888,9 @@ timepair_t AtomSpaceBenchmark::bm_getHandlesByType()
         std::ostringstream dss;
         dss << "aspace.get_atoms_by_type(" << t << ", True)\n";
         std::string ps = dss.str();
-        clock_t t_begin = clock();
+        clock_t t_begin = timerStart();
         pyev->eval(ps);
-        clock_t time_taken = clock() - t_begin;
+        clock_t time_taken = timerStop(t_begin);
         return timepair_t(Nclock*time_taken,0);
     }
 #endif /* HAVE_CYTHON */
@@ -1539,22 +3901,841 @@ timepair_t AtomSpaceBenchmark::bm_getHandlesByType()
     }
 #endif /* HAVE_GUILE */
     case BENCH_TABLE: {
-        clock_t t_begin = clock();
+        clock_t t_begin = timerStart();
         HandleSeq results;
-        atab->getHandlesByType(back_inserter(results), t, true);
-        clock_t time_taken = clock() - t_begin;
+        TIMED_OP(atab->getHandlesByType(back_inserter(results), t, true));
+        clock_t time_taken = timerStop(t_begin);
         return timepair_t(Nclock*time_taken,0);
     }
     case BENCH_AS: {
         HandleSeq results;
-        clock_t t_begin = clock();
-        asp->get_handles_by_type(back_inserter(results), t, true);
-        clock_t time_taken = clock() - t_begin;
+        clock_t t_begin = timerStart();
+        TIMED_OP(asp->get_handles_by_type(back_inserter(results), t, true));
+        clock_t time_taken = timerStop(t_begin);
         return timepair_t(Nclock*time_taken,0);
     }}
     return timepair_t(0,0);
 }
 
+size_t AtomSpaceBenchmark::atomsOfType(Type t, bool subclass) const
+{
+    return (testKind == BENCH_TABLE) ? atab->getNumAtomsOfType(t, subclass)
+                                     : asp->get_num_atoms_of_type(t, subclass);
+}
+
+// A random type that has atoms; with subclass, one that also has
+// subtypes, so that its scan goes through several buckets of the
+// type index.
+Type AtomSpaceBenchmark::randomScanType(bool subclass)
+{
+    if (scanParents.empty())
+    {
+        scanParents.assign(numberOfTypes, false);
+        for (Type t = ATOM; t < numberOfTypes; t++)
+            for (Type s = ATOM; s < numberOfTypes; s++)
+                if (s != t and nameserver().isA(s, t)) scanParents[t] = true;
+    }
+
+    std::vector<Type> types;
+    for (Type t = ATOM; t < numberOfTypes; t++)
+        if ((scanParents[t] or not subclass) and 0 < atomsOfType(t, subclass))
+            types.push_back(t);
+    if (types.empty()) return ATOM;
+    return types[randomGenerator->randint(types.size())];
+}
+
+// Visit every atom of type t through the callback of the type index,
+// without copying out the handles. Touching the type makes sure that
+// the atoms themselves are read, as a real scan would.
+timepair_t AtomSpaceBenchmark::runScan(Type t, bool subclass)
+{
+    uint64_t n = 0;
+    int sum = 0;
+    auto visit = [&](const Handle& h) { n++; sum += h->get_type(); };
+
+    clock_t t_begin = timerStart();
+    if (testKind == BENCH_TABLE) {
+        TIMED_OP(atab->foreachHandleByType(visit, t, subclass));
+    } else {
+        TIMED_OP(asp->foreach_handle_of_type(t, visit, subclass));
+    }
+    clock_t time_taken = timerStop(t_begin);
+    global += sum;
+    scanAtoms += n;
+    scanTicks += time_taken;
+    // As for getHandlesByType, a scan counts as Nclock operations.
+    return timepair_t(Nclock*time_taken,0);
+}
+
+timepair_t AtomSpaceBenchmark::bm_scanType()
+{
+    if (testKind != BENCH_AS and testKind != BENCH_TABLE)
+        return timepair_t(0,0);
+    return runScan(randomScanType(false), false);
+}
+
+timepair_t AtomSpaceBenchmark::bm_scanSubclass()
+{
+    if (testKind != BENCH_AS and testKind != BENCH_TABLE)
+        return timepair_t(0,0);
+    return runScan(randomScanType(true), true);
+}
+
+// Scan the whole atomspace on scanThreads threads. The type index is
+// split by type: the types, biggest first, each go to the thread with
+// the fewest atoms so far.
+timepair_t AtomSpaceBenchmark::bm_scanParallel()
+{
+    if (testKind != BENCH_AS and testKind != BENCH_TABLE)
+        return timepair_t(0,0);
+
+    std::vector<std::pair<size_t, Type>> types;
+    for (Type t = ATOM; t < numberOfTypes; t++)
+    {
+        size_t n = atomsOfType(t, false);
+        if (0 < n) types.push_back({n, t});
+    }
+    std::sort(types.rbegin(), types.rend());
+    int nt = std::max(1, scanThreads);
+    std::vector<std::vector<Type>> share(nt);
+    std::vector<size_t> load(nt, 0);
+    for (const auto& st : types)
+    {
+        int least = std::min_element(load.begin(), load.end()) - load.begin();
+        share[least].push_back(st.second);
+        load[least] += st.first;
+    }
+
+    std::vector<uint64_t> counts(nt, 0);
+    std::vector<int> sums(nt, 0);
+    std::atomic<int> ready(0);
+    std::atomic<bool> go(false);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < nt; t++) {
+        threads.emplace_back([&, t]() {
+            uint64_t n = 0;
+            int sum = 0;
+            auto visit = [&](const Handle& h) { n++; sum += h->get_type(); };
+            ready++;
+            while (not go) std::this_thread::yield();
+            if (profiler) SampleProfiler::resume();
+            for (Type type : share[t])
+            {
+                if (testKind == BENCH_TABLE)
+                    atab->foreachHandleByType(visit, type, false);
+                else
+                    asp->foreach_handle_of_type(type, visit, false);
+            }
+            if (profiler) SampleProfiler::pause();
+            counts[t] = n;
+            sums[t] = sum;
+        });
+    }
+    while (ready < nt) std::this_thread::yield();
+
+    // Wall-clock time, as clock() would add up the CPU time of all
+    // the threads.
+    int saveThreads = nThreads;
+    if (1 < nt) nThreads = nt;
+    clock_t t_begin = timerStart();
+    uint64_t op_begin = monotonic_ns();
+    go = true;
+    for (std::thread& th : threads) th.join();
+    if (latencyHist) latencyHist->record(monotonic_ns() - op_begin);
+    clock_t time_taken = timerStop(t_begin);
+    nThreads = saveThreads;
+
+    for (int t = 0; t < nt; t++) {
+        scanAtoms += counts[t];
+        global += sums[t];
+    }
+    scanTicks += time_taken;
+    return timepair_t(Nclock*time_taken,0);
+}
+
+// A lookup of an atom that exists with probability lookupHitRatio. The
+// hits go by the read access pattern; a missing node gets a new name,
+// and a missing link has the last atom of an existing link's outgoing
+// set replaced by a random atom, so that it keeps the same arity.
+void AtomSpaceBenchmark::prepareLookup(Lookup& q, bool link)
+{
+    Handle h = getReadHandle();
+    for (int tries = 0; h->is_link() != link; tries++)
+    {
+        OC_ASSERT(tries < 10000, "No %s in the test atomspace",
+                  link ? "links" : "nodes");
+        h = getReadHandle();
+    }
+    q.hit = randomGenerator->randdouble() < lookupHitRatio;
+    q.type = h->get_type();
+    if (link)
+    {
+        q.oset = h->getOutgoingSet();
+        if (q.hit) return;
+        if (q.oset.empty()) q.oset.push_back(getRandomHandle());
+        else q.oset.back() = getRandomHandle();
+    }
+    else if (q.hit)
+        q.name = h->get_name();
+    else
+        q.name = (NUMBER_NODE == q.type) ? "-" + std::to_string(++counter) :
+                 "missing " + std::to_string(++counter);
+}
+
+Handle AtomSpaceBenchmark::lookupOne(LookupKind kind, Lookup& q)
+{
+    bool table = (testKind == BENCH_TABLE);
+    switch (kind)
+    {
+    case LOOKUP_NODE:
+        return table ? atab->getHandle(q.type, std::move(q.name)) :
+                       asp->get_node(q.type, std::move(q.name));
+    case LOOKUP_LINK:
+        return table ? atab->getHandle(q.type, std::move(q.oset)) :
+                       asp->get_link(q.type, std::move(q.oset));
+    case LOOKUP_ADD_NODE:
+        return table ? atab->add(createNode(q.type, std::move(q.name)), false) :
+                       asp->add_node(q.type, std::move(q.name));
+    }
+    return Handle::UNDEFINED;
+}
+
+// The lookups meant to hit run first, and those meant to miss after,
+// so that each kind is one stretch of the timed region, ended by a
+// clock read. Single lookups are only timed with -H, for the
+// percentiles, as TIMED_OP does in the other methods; the timer
+// calibration then counts that in.
+timepair_t AtomSpaceBenchmark::runLookups(LookupKind kind)
+{
+    if (testKind != BENCH_AS and testKind != BENCH_TABLE)
+        return timepair_t(0,0);
+
+    std::vector<Lookup> lookups(Nclock);
+    for (Lookup& q : lookups) prepareLookup(q, LOOKUP_LINK == kind);
+    size_t nhit = std::partition(lookups.begin(), lookups.end(),
+        [](const Lookup& q) { return q.hit; }) - lookups.begin();
+
+    // With -H, TIMED_OP records into the histogram of each kind.
+    LatencyHistogram* saveHist = latencyHist;
+    std::vector<LatencyHistogram> opHist(saveHist ? 2 : 0);
+    if (saveHist) latencyHist = &opHist[1];
+    uint64_t found[2] = { 0, 0 };
+
+    clock_t t_begin = timerStart();
+    uint64_t start = monotonic_ns();
+    uint64_t split = start;
+    for (size_t i = 0; i < Nclock; i++)
+    {
+        if (i == nhit)
+        {
+            split = monotonic_ns();
+            if (saveHist) latencyHist = &opHist[0];
+        }
+        Handle h;
+        TIMED_OP(h = lookupOne(kind, lookups[i]));
+        found[i < nhit] += (nullptr != h);
+    }
+    uint64_t end = monotonic_ns();
+    clock_t time_taken = timerStop(t_begin);
+    if (nhit == Nclock) split = end;
+    latencyHist = saveHist;
+
+    // add_node() returns the node either way, but the names make the
+    // nodes meant to be there exist, and the others not.
+    if (LOOKUP_ADD_NODE == kind)
+    {
+        found[1] = nhit;
+        found[0] = 0;
+    }
+    // Less the calibrated loop overhead, as for the whole region.
+    double opNs = subtractOverhead ? overheadPerOp * 1.0e9 / CLOCKS_PER_SEC : 0.0;
+    lookupGroups[1].count += nhit;
+    lookupGroups[1].ns += std::max(1.0, (split - start) - opNs * nhit);
+    lookupGroups[0].count += Nclock - nhit;
+    lookupGroups[0].ns += std::max(1.0, (end - split) - opNs * (Nclock - nhit));
+    for (int hit = 0; hit < 2; hit++)
+    {
+        lookupGroups[hit].found += found[hit];
+        if (not saveHist) continue;
+        lookupGroups[hit].hist.merge(opHist[hit]);
+        saveHist->merge(opHist[hit]);
+    }
+    global += found[0] + found[1];
+    return timepair_t(time_taken,0);
+}
+
+timepair_t AtomSpaceBenchmark::bm_getNode()
+{
+    return runLookups(LOOKUP_NODE);
+}
+
+timepair_t AtomSpaceBenchmark::bm_getLink()
+{
+    return runLookups(LOOKUP_LINK);
+}
+
+// add_node() of a node that may already be there: a hit is the find
+// path of insert-or-find, a miss allocates and inserts.
+timepair_t AtomSpaceBenchmark::bm_addNodeExisting()
+{
+    return runLookups(LOOKUP_ADD_NODE);
+}
+
+// ================================================================
+// Mixed workloads: a weighted random mix of single operations, as
+// given with -W, e.g. "getTV=60,setTV=20,addLink=15,removeAtom=5".
+
+static const char* mixOpNames[] = {
+    "getType", "getTV", "setTV", "getIncomingSet", "getIncomingSetSize",
+    "getOutgoingSet", "getValue", "setValue", "addNode", "addLink",
+    "removeAtom", "removeAtomFailed"
+};
+
+bool AtomSpaceBenchmark::setMix(const std::string& spec)
+{
+    mixWeights.assign(NUM_MIX_OPS, 0.0);
+    double total = 0.0;
+    std::istringstream iss(spec);
+    std::string item;
+    while (std::getline(iss, item, ','))
+    {
+        size_t eq = item.find('=');
+        std::string name = item.substr(0, eq);
+        double weight = (eq == std::string::npos) ?
+                        1.0 : atof(item.substr(eq + 1).c_str());
+        if (name == "getTruthValue") name = "getTV";
+        if (name == "setTruthValue") name = "setTV";
+
+        int op = 0;
+        while (op < NUM_MIX_OPS and name != mixOpNames[op]) op++;
+        if (op == NUM_MIX_OPS or weight < 0.0)
+        {
+            cerr << "Error: bad operation in mix: " << item << endl;
+            return false;
+        }
+        mixWeights[op] += weight;
+        total += weight;
+    }
+    if (total <= 0.0)
+    {
+        cerr << "Error: empty operation mix: " << spec << endl;
+        return false;
+    }
+    for (double& w : mixWeights) w /= total;
+    mixHist.assign(NUM_MIX_OPS + 1, LatencyHistogram());
+    mixCount.assign(NUM_MIX_OPS + 1, 0);
+    return true;
+}
+
+AtomSpaceBenchmark::MixOp AtomSpaceBenchmark::randomMixOp()
+{
+    double p = randomGenerator->randdouble();
+    for (int op = 0; op < NUM_MIX_OPS - 1; op++)
+    {
+        if (p < mixWeights[op]) return (MixOp) op;
+        p -= mixWeights[op];
+    }
+    return (MixOp) (NUM_MIX_OPS - 1);
+}
+
+// Pre-generate the operation and its arguments, outside of the timed
+// region.
+void AtomSpaceBenchmark::prepareMixStep(MixStep& st)
+{
+    st.op = randomMixOp();
+    switch (st.op)
+    {
+    case MIX_SET_TV:
+        st.strength = randomGenerator->randfloat();
+        st.conf = randomGenerator->randfloat();
+        st.h = getRandomHandle();
+        break;
+    case MIX_ADD_NODE:
+        st.type = defaultNodeType;
+        if (randomGenerator->randdouble() < chanceOfNonDefaultNode)
+            st.type = randomType(NODE);
+        counter++;
+        st.name = (NUMBER_NODE == st.type) ? std::to_string(counter) :
+                  "node " + std::to_string(counter);
+        break;
+    case MIX_ADD_LINK: {
+        st.type = defaultLinkType;
+        if (randomGenerator->randdouble() < chanceOfNonDefaultLink)
+            st.type = randomType(LINK);
+        size_t arity = randomArity();
+        if (CONTEXT_LINK == st.type) arity = 2;
+        st.oset.clear();
+        for (size_t j = 0; j < arity; j++)
+            st.oset.push_back(getRandomHandle());
+        break;
+    }
+    case MIX_REMOVE_ATOM:
+        // Each leaf comes out of the pool once, so no atom is removed
+        // twice; the pool may have run dry, though.
+        st.h = leaves->take(*randomGenerator);
+        break;
+    case MIX_GET_VALUE:
+        st.h = getReadHandle();
+        st.key = randomValueKey();
+        break;
+    case MIX_SET_VALUE:
+        st.h = getRandomHandle();
+        st.key = randomValueKey();
+        st.values = { randomGenerator->randdouble(),
+                      randomGenerator->randdouble() };
+        break;
+    default:
+        st.h = getReadHandle();
+        break;
+    }
+}
+
+// Run one pre-generated step of the mix; returns something to sum,
+// so that the reads are not optimized away.
+int AtomSpaceBenchmark::runMixStep(MixStep& st)
+{
+    switch (st.op)
+    {
+    case MIX_GET_TYPE:
+        return st.h->get_type();
+    case MIX_GET_TV:
+        st.h->getTruthValue();
+        break;
+    case MIX_SET_TV:
+        st.h->setTruthValue(SimpleTruthValue::createTV(st.strength, st.conf));
+        break;
+    case MIX_GET_INCOMING:
+        st.h->getIncomingSet();
+        break;
+    case MIX_GET_INCOMING_SIZE:
+        return st.h->getIncomingSetSize();
+    case MIX_GET_OUTGOING:
+        if (st.h->is_link()) st.h->getOutgoingSet();
+        break;
+    case MIX_GET_VALUE:
+        st.h->getValue(st.key);
+        break;
+    case MIX_SET_VALUE:
+        st.h->setValue(st.key, createFloatValue(st.values));
+        break;
+    // Keep what was added, for --record.
+    case MIX_ADD_NODE:
+        if (testKind == BENCH_TABLE)
+            st.h = atab->add(createNode(st.type, std::move(st.name)), false);
+        else
+            st.h = asp->add_node(st.type, std::move(st.name));
+        break;
+    case MIX_ADD_LINK:
+        if (testKind == BENCH_TABLE)
+            st.h = atab->add(createLink(std::move(st.oset), st.type), false);
+        else
+            st.h = asp->add_link(st.type, std::move(st.oset));
+        break;
+    case MIX_REMOVE_ATOM:
+        // An addLink earlier in the batch may have put the leaf in its
+        // outgoing set; then remove_atom() would do nothing.
+        if (not st.h or 0 < st.h->getIncomingSetSize())
+        {
+            st.op = MIX_REMOVE_FAILED;
+            break;
+        }
+        if (testKind == BENCH_TABLE)
+            atab->extract(st.h);
+        else
+            asp->remove_atom(st.h);
+        break;
+    default:
+        break;
+    }
+    return 0;
+}
+
+timepair_t AtomSpaceBenchmark::bm_mix()
+{
+    if (testKind != BENCH_AS and testKind != BENCH_TABLE)
+        return timepair_t(0,0);
+
+    std::vector<MixStep> steps(Nclock);
+    for (MixStep& st : steps) prepareMixStep(st);
+
+    // With -H, each step is timed on its own, as by TIMED_OP, and
+    // recorded after the timed region.
+    int sum = 0;
+    clock_t t_begin = timerStart();
+    if (latencyHist)
+        for (MixStep& st : steps)
+        {
+            uint64_t op_begin = monotonic_ns();
+            sum += runMixStep(st);
+            st.ns = monotonic_ns() - op_begin;
+        }
+    else
+        for (MixStep& st : steps) sum += runMixStep(st);
+    clock_t time_taken = timerStop(t_begin);
+    global += sum;
+    for (MixStep& st : steps)
+    {
+        mixCount[st.op]++;
+        if (not latencyHist) continue;
+        mixHist[st.op].record(st.ns);
+        latencyHist->record(st.ns);
+    }
+    for (MixStep& st : steps)
+        if (MIX_REMOVE_ATOM == st.op) leaves->removed(st.h);
+    if (recorder)
+        for (MixStep& st : steps) recordMixStep(st);
+    return timepair_t(time_taken,0);
+}
+
+// A few predicate nodes to use as value keys, added on first use.
+Handle AtomSpaceBenchmark::randomValueKey()
+{
+    if (valueKeys.empty())
+    {
+        for (int k = 0; k < 4; k++)
+        {
+            std::string name = "bm-value-key-" + std::to_string(k);
+            if (testKind == BENCH_TABLE)
+                valueKeys.push_back(atab->add(
+                    createNode(PREDICATE_NODE, std::move(name)), false));
+            else
+                valueKeys.push_back(
+                    asp->add_node(PREDICATE_NODE, std::move(name)));
+        }
+    }
+    return valueKeys[randomGenerator->randint(valueKeys.size())];
+}
+
+// ================================================================
+// Recording and replaying traces; see Trace.h.
+
+// Called after the timed region, so recording costs nothing there.
+void AtomSpaceBenchmark::recordMixStep(const MixStep& st)
+{
+    switch (st.op)
+    {
+    case MIX_GET_TYPE:
+        recorder->access(TRACE_GET_TYPE, workerIndex, st.h);
+        break;
+    case MIX_GET_TV:
+        recorder->access(TRACE_GET_TV, workerIndex, st.h);
+        break;
+    case MIX_SET_TV:
+        recorder->setTV(workerIndex, st.h, st.strength, st.conf);
+        break;
+    case MIX_GET_INCOMING:
+        recorder->access(TRACE_GET_INCOMING, workerIndex, st.h);
+        break;
+    case MIX_GET_INCOMING_SIZE:
+        recorder->access(TRACE_GET_INCOMING_SIZE, workerIndex, st.h);
+        break;
+    case MIX_GET_OUTGOING:
+        recorder->access(TRACE_GET_OUTGOING, workerIndex, st.h);
+        break;
+    case MIX_GET_VALUE:
+        recorder->getValue(workerIndex, st.h, st.key);
+        break;
+    case MIX_SET_VALUE:
+        recorder->setValue(workerIndex, st.h, st.key, st.values);
+        break;
+    case MIX_ADD_NODE:
+    case MIX_ADD_LINK:
+        if (st.h) recorder->added(workerIndex, st.h);
+        break;
+    case MIX_REMOVE_ATOM:
+        recorder->access(TRACE_REMOVE, workerIndex, st.h);
+        break;
+    default:
+        break;
+    }
+}
+
+int AtomSpaceBenchmark::replayStep(TraceStep& st, ReplayTable& table)
+{
+    switch (st.op)
+    {
+    case TRACE_DEFINE_NODE:
+    case TRACE_ADD_NODE:
+        if (testKind == BENCH_TABLE)
+            table.set(st.atom, atab->add(
+                createNode(st.type, std::move(st.name)), false));
+        else
+            table.set(st.atom, asp->add_node(st.type, std::move(st.name)));
+        return 0;
+    case TRACE_DEFINE_LINK:
+    case TRACE_ADD_LINK: {
+        HandleSeq oset;
+        oset.reserve(st.oset.size());
+        for (uint32_t o : st.oset) oset.push_back(table.get(o));
+        if (testKind == BENCH_TABLE)
+            table.set(st.atom, atab->add(
+                createLink(std::move(oset), st.type), false));
+        else
+            table.set(st.atom, asp->add_link(st.type, std::move(oset)));
+        return 0;
+    }
+    default:
+        break;
+    }
+
+    const Handle& h = table.get(st.atom);
+    if (nullptr == h) return 0;
+    switch (st.op)
+    {
+    case TRACE_GET_TYPE:
+        return h->get_type();
+    case TRACE_GET_TV:
+        h->getTruthValue();
+        break;
+    case TRACE_SET_TV:
+        h->setTruthValue(SimpleTruthValue::createTV(st.strength, st.conf));
+        break;
+    case TRACE_GET_VALUE:
+        h->getValue(table.get(st.key));
+        break;
+    case TRACE_SET_VALUE:
+        h->setValue(table.get(st.key), createFloatValue(st.values));
+        break;
+    case TRACE_GET_INCOMING:
+        h->getIncomingSet();
+        break;
+    case TRACE_GET_INCOMING_SIZE:
+        return h->getIncomingSetSize();
+    case TRACE_GET_OUTGOING:
+        if (h->is_link()) h->getOutgoingSet();
+        break;
+    case TRACE_REMOVE:
+        if (testKind == BENCH_TABLE)
+            atab->extract(h);
+        else
+            asp->remove_atom(h);
+        break;
+    default:
+        break;
+    }
+    return 0;
+}
+
+// Replay the trace as fast as possible. The atoms that existed before
+// it was recorded are added first, untimed. With several threads, the
+// steps of each recording thread go to the same replaying thread, in
+// their recorded order.
+BenchResult AtomSpaceBenchmark::doReplay(const Trace& trace, int numThreads)
+{
+    cout << "Replaying " << trace.steps.size() << " operations on "
+         << numThreads << " thread(s) " << flush;
+
+    ReplayTable table(trace.atoms);
+    TruthValuePtr defaultTV = TruthValue::DEFAULT_TV();
+    for (TraceStep st : trace.setup)
+    {
+        replayStep(st, table);
+        if (st.strength != defaultTV->get_mean() or
+            st.conf != defaultTV->get_confidence())
+            table.get(st.atom)->setTruthValue(
+                SimpleTruthValue::createTV(st.strength, st.conf));
+    }
+    std::vector<std::vector<TraceStep>> streams(numThreads);
+    for (const TraceStep& st : trace.steps)
+        streams[st.thread % numThreads].push_back(st);
+
+    std::vector<LatencyHistogram> latency(numThreads);
+    std::vector<int> sums(numThreads, 0);
+    std::atomic<int> ready(0);
+    std::atomic<bool> go(false);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < numThreads; t++) {
+        threads.emplace_back([&, t]() {
+            ready++;
+            while (not go) std::this_thread::yield();
+            if (profiler) SampleProfiler::resume();
+            int sum = 0;
+            for (TraceStep& st : streams[t])
+            {
+                if (not perOpLatency)
+                {
+                    sum += replayStep(st, table);
+                    continue;
+                }
+                uint64_t op_begin = monotonic_ns();
+                sum += replayStep(st, table);
+                latency[t].record(monotonic_ns() - op_begin);
+            }
+            sums[t] = sum;
+            if (profiler) SampleProfiler::pause();
+        });
+    }
+    while (ready < numThreads) std::this_thread::yield();
+    uint64_t t0 = monotonic_ns();
+    go = true;
+    for (std::thread& th : threads) th.join();
+    uint64_t t1 = monotonic_ns();
+
+    LatencyHistogram merged;
+    for (int t = 0; t < numThreads; t++) {
+        merged.merge(latency[t]);
+        global += sums[t];
+    }
+
+    BenchResult res;
+    res.method = "replay";
+    res.api = apiName();
+    res.threads = numThreads;
+    res.ops = trace.steps.size();
+    res.wallSeconds = (t1 - t0) / 1.0e9;
+    res.opsPerSec = res.ops / res.wallSeconds;
+    res.samples.push_back(res.opsPerSec);
+    res.extra["trace_atoms"] = trace.atoms;
+    res.extra["recorded_threads"] = trace.threads;
+
+    printf("\n%.6lf seconds elapsed, %.2f per second\n",
+           res.wallSeconds, res.opsPerSec);
+    if (perOpLatency)
+    {
+        printLatency(merged);
+        addLatency(res, merged);
+    }
+    cout << DIVIDER_LINE << endl;
+    return res;
+}
+
+bool AtomSpaceBenchmark::runReplay(int numThreads)
+{
+    Trace trace;
+    std::string error;
+    if (not readTrace(replayFile, trace, error))
+    {
+        cerr << "Error: " << error << endl;
+        return false;
+    }
+    cout << "Trace " << replayFile << ": " << trace.steps.size()
+         << " operations on " << trace.atoms << " atoms, of which "
+         << trace.setup.size() << " existed before; recorded on "
+         << trace.threads << " thread(s)" << endl;
+    for (int op = TRACE_ADD_NODE; op < NUM_TRACE_OPS; op++)
+        if (trace.count[op])
+            printf("  %-20s %lu\n", traceOpName((TraceOp) op),
+                   (unsigned long) trace.count[op]);
+
+    std::vector<double> samples;
+    BenchResult res;
+    if (profiler) profiler->start();
+    for (int r = 0; r < repetitions; r++) {
+        setupAtomSpace();
+        res = doReplay(trace, numThreads);
+        teardownAtomSpace();
+        samples.push_back(res.opsPerSec);
+    }
+    if (profiler)
+        profiler->stop(1 == numThreads ? "replay" :
+                       "replay@" + std::to_string(numThreads));
+    res.samples = samples;
+    res.opsPerSec = median(samples);
+    recordResult(res);
+    return true;
+}
+
+// Count and share of each operation of the mix, and with -H its
+// throughput, counted over the time spent in that operation only, and
+// its latency. The combined throughput is that of the whole region.
+void AtomSpaceBenchmark::printMix(BenchResult& res)
+{
+    uint64_t total = 0;
+    for (uint64_t n : mixCount) total += n;
+    if (0 == total) return;
+
+    LatencyHistogram combined;
+    for (const LatencyHistogram& hist : mixHist) combined.merge(hist);
+    cout << "Operation mix, latencies in nanoseconds:" << endl;
+    printf("%-20s %10s %7s %14s %9s %9s %9s %9s\n", "operation", "count",
+           "share", "ops/sec", "p50", "p99", "p99.9", "max");
+    for (int op = 0; op <= MIX_REMOVE_FAILED + 1; op++)
+    {
+        bool all = (MIX_REMOVE_FAILED < op);
+        uint64_t count = all ? total : mixCount[op];
+        if (0 == count) continue;
+        const LatencyHistogram& hist = all ? combined : mixHist[op];
+        const char* name = all ? "combined" : mixOpNames[op];
+        std::string key = name;
+        printf("%-20s %10lu %6.2f%% ", name, (unsigned long) count,
+               100.0 * count / total);
+        if (0 == hist.count())
+        {
+            if (all) printf("%14.0f", res.opsPerSec);
+            else printf("%14s", "-");
+            if (all) res.extra[key + "_ops_per_sec"] = res.opsPerSec;
+            printf(" %9s %9s %9s %9s\n", "-", "-", "-", "-");
+            continue;
+        }
+        double rate = all ? res.opsPerSec :
+            hist.count() / (hist.sum() / 1.0e9);
+        printf("%14.0f %9lu %9lu %9lu %9lu\n", rate,
+               (unsigned long) hist.percentile(50.0),
+               (unsigned long) hist.percentile(99.0),
+               (unsigned long) hist.percentile(99.9),
+               (unsigned long) hist.max());
+        res.extra[key + "_ops_per_sec"] = rate;
+        res.extra[key + "_p99_ns"] = hist.percentile(99.0);
+    }
+    if (0 < mixCount[MIX_REMOVE_FAILED])
+        res.extra["removeAtomFailed_count"] = mixCount[MIX_REMOVE_FAILED];
+}
+
+// Throughput of the lookups meant to hit and of those meant to miss,
+// over the time spent in each kind only, and with -H their latencies.
+void AtomSpaceBenchmark::printLookup(BenchResult& res)
+{
+    uint64_t total = lookupGroups[0].count + lookupGroups[1].count;
+    if (0 == total) return;
+
+    // A changed link can happen to exist.
+    double achieved =
+        (double) (lookupGroups[0].found + lookupGroups[1].found) / total;
+    printf("Lookups (hit ratio %.3f asked, %.3f got), "
+           "latencies in nanoseconds:\n", lookupHitRatio, achieved);
+    printf("%-8s %10s %14s %9s %9s %9s %9s\n", "", "count", "ops/sec",
+           "p50", "p99", "p99.9", "max");
+    for (int hit = 1; 0 <= hit; hit--)
+    {
+        const LookupGroup& g = lookupGroups[hit];
+        if (0 == g.count) continue;
+        const char* name = hit ? "hit" : "miss";
+        double rate = g.count / (std::max(g.ns, (uint64_t) 1) / 1.0e9);
+        std::string key = name;
+        res.extra[key + "_ops_per_sec"] = rate;
+        if (0 == g.hist.count())
+        {
+            printf("%-8s %10lu %14.0f %9s %9s %9s %9s\n", name,
+                   (unsigned long) g.count, rate, "-", "-", "-", "-");
+            continue;
+        }
+        printf("%-8s %10lu %14.0f %9lu %9lu %9lu %9lu\n", name,
+               (unsigned long) g.count, rate,
+               (unsigned long) g.hist.percentile(50.0),
+               (unsigned long) g.hist.percentile(99.0),
+               (unsigned long) g.hist.percentile(99.9),
+               (unsigned long) g.hist.max());
+        res.extra[key + "_p99_ns"] = g.hist.percentile(99.0);
+    }
+    if (0 < lookupGroups[0].found)
+        printf("%lu of the misses found an atom after all\n",
+               (unsigned long) lookupGroups[0].found);
+    res.extra["hit_ratio"] = lookupHitRatio;
+    res.extra["achieved_hit_ratio"] = achieved;
+}
+
+// Atoms per second of the scan methods, over the time of the scans.
+void AtomSpaceBenchmark::printScan(BenchResult& res)
+{
+    if (0 == scanAtoms or 0 == scanTicks) return;
+    double rate = scanAtoms / ((double) scanTicks / CLOCKS_PER_SEC);
+    double scans = (double) res.ops / Nclock;
+    printf("Scanned %lu atoms, %.0f per scan: %.2f atoms per second\n",
+           (unsigned long) scanAtoms, scanAtoms / scans, rate);
+    res.extra["atoms_per_sec"] = rate;
+    res.extra["atoms_per_scan"] = scanAtoms / scans;
+}
+
 // ================================================================
 // ================================================================
 // ================================================================
@@ -1568,20 +4749,20 @@ timepair_t AtomSpaceBenchmark::bm_push_back()
 
     if (1 == Nreserve)
     {
-        clock_t t_begin = clock();
+        clock_t t_begin = timerStart();
         for (unsigned int i = 0; i<Nclock; i++)
         {
             // HandleSeq oset;
             HandleSeq oset;
             oset.push_back(ha);
         }
-        clock_t time_taken = clock() - t_begin;
+        clock_t time_taken = timerStop(t_begin);
         return timepair_t(time_taken,0);
     }
 
     if (2 == Nreserve)
     {
-        clock_t t_begin = clock();
+        clock_t t_begin = timerStart();
         for (unsigned int i = 0; i<Nclock; i++)
         {
             // HandleSeq oset;
@@ -1589,13 +4770,13 @@ timepair_t AtomSpaceBenchmark::bm_push_back()
             oset.push_back(ha);
             oset.push_back(hb);
         }
-        clock_t time_taken = clock() - t_begin;
+        clock_t time_taken = timerStop(t_begin);
         return timepair_t(time_taken,0);
     }
 
     if (3 == Nreserve)
     {
-        clock_t t_begin = clock();
+        clock_t t_begin = timerStart();
         for (unsigned int i = 0; i<Nclock; i++)
         {
             // HandleSeq oset;
@@ -1604,13 +4785,13 @@ timepair_t AtomSpaceBenchmark::bm_push_back()
             oset.push_back(hb);
             oset.push_back(hc);
         }
-        clock_t time_taken = clock() - t_begin;
+        clock_t time_taken = timerStop(t_begin);
         return timepair_t(time_taken,0);
     }
 
     if (4 == Nreserve)
     {
-        clock_t t_begin = clock();
+        clock_t t_begin = timerStart();
         for (unsigned int i = 0; i<Nclock; i++)
         {
             // HandleSeq oset;
@@ -1620,7 +4801,7 @@ timepair_t AtomSpaceBenchmark::bm_push_back()
             oset.push_back(hc);
             oset.push_back(hd);
         }
-        clock_t time_taken = clock() - t_begin;
+        clock_t time_taken = timerStop(t_begin);
         return timepair_t(time_taken,0);
     }
 
@@ -1637,7 +4818,7 @@ timepair_t AtomSpaceBenchmark::bm_push_back_reserve()
 
     if (1 == Nreserve)
     {
-        clock_t t_begin = clock();
+        clock_t t_begin = timerStart();
         for (unsigned int i = 0; i<Nclock; i++)
         {
             // HandleSeq oset;
@@ -1645,13 +4826,13 @@ timepair_t AtomSpaceBenchmark::bm_push_back_reserve()
             oset.reserve(Nreserve);
             oset.push_back(ha);
         }
-        clock_t time_taken = clock() - t_begin;
+        clock_t time_taken = timerStop(t_begin);
         return timepair_t(time_taken,0);
     }
 
     if (2 == Nreserve)
     {
-        clock_t t_begin = clock();
+        clock_t t_begin = timerStart();
         for (unsigned int i = 0; i<Nclock; i++)
         {
             // HandleSeq oset;
@@ -1660,13 +4841,13 @@ timepair_t AtomSpaceBenchmark::bm_push_back_reserve()
             oset.push_back(ha);
             oset.push_back(hb);
         }
-        clock_t time_taken = clock() - t_begin;
+        clock_t time_taken = timerStop(t_begin);
         return timepair_t(time_taken,0);
     }
 
     if (3 == Nreserve)
     {
-        clock_t t_begin = clock();
+        clock_t t_begin = timerStart();
         for (unsigned int i = 0; i<Nclock; i++)
         {
             // HandleSeq oset;
@@ -1676,13 +4857,13 @@ timepair_t AtomSpaceBenchmark::bm_push_back_reserve()
             oset.push_back(hb);
             oset.push_back(hc);
         }
-        clock_t time_taken = clock() - t_begin;
+        clock_t time_taken = timerStop(t_begin);
         return timepair_t(time_taken,0);
     }
 
     if (4 == Nreserve)
     {
-        clock_t t_begin = clock();
+        clock_t t_begin = timerStart();
         for (unsigned int i = 0; i<Nclock; i++)
         {
             // HandleSeq oset;
@@ -1693,7 +4874,7 @@ timepair_t AtomSpaceBenchmark::bm_push_back_reserve()
             oset.push_back(hc);
             oset.push_back(hd);
         }
-        clock_t time_taken = clock() - t_begin;
+        clock_t time_taken = timerStop(t_begin);
         return timepair_t(time_taken,0);
     }
 
@@ -1709,32 +4890,32 @@ timepair_t AtomSpaceBenchmark::bm_emplace_back()
 
     if (1 == Nreserve)
     {
-        clock_t t_begin = clock();
+        clock_t t_begin = timerStart();
         for (unsigned int i = 0; i<Nclock; i++)
         {
             HandleSeq oset;
             oset.emplace_back(ha);
         }
-        clock_t time_taken = clock() - t_begin;
+        clock_t time_taken = timerStop(t_begin);
         return timepair_t(time_taken,0);
     }
 
     if (2 == Nreserve)
     {
-        clock_t t_begin = clock();
+        clock_t t_begin = timerStart();
         for (unsigned int i = 0; i<Nclock; i++)
         {
             HandleSeq oset;
             oset.emplace_back(ha);
             oset.emplace_back(hb);
         }
-        clock_t time_taken = clock() - t_begin;
+        clock_t time_taken = timerStop(t_begin);
         return timepair_t(time_taken,0);
     }
 
     if (3 == Nreserve)
     {
-        clock_t t_begin = clock();
+        clock_t t_begin = timerStart();
         for (unsigned int i = 0; i<Nclock; i++)
         {
             HandleSeq oset;
@@ -1742,13 +4923,13 @@ timepair_t AtomSpaceBenchmark::bm_emplace_back()
             oset.emplace_back(hb);
             oset.emplace_back(hc);
         }
-        clock_t time_taken = clock() - t_begin;
+        clock_t time_taken = timerStop(t_begin);
         return timepair_t(time_taken,0);
     }
 
     if (4 == Nreserve)
     {
-        clock_t t_begin = clock();
+        clock_t t_begin = timerStart();
         for (unsigned int i = 0; i<Nclock; i++)
         {
             HandleSeq oset;
@@ -1757,7 +4938,7 @@ timepair_t AtomSpaceBenchmark::bm_emplace_back()
             oset.emplace_back(hc);
             oset.emplace_back(hd);
         }
-        clock_t time_taken = clock() - t_begin;
+        clock_t time_taken = timerStop(t_begin);
         return timepair_t(time_taken,0);
     }
 
@@ -1773,20 +4954,20 @@ timepair_t AtomSpaceBenchmark::bm_emplace_back_reserve()
 
     if (1 == Nreserve)
     {
-        clock_t t_begin = clock();
+        clock_t t_begin = timerStart();
         for (unsigned int i = 0; i<Nclock; i++)
         {
             HandleSeq oset;
             oset.reserve(Nreserve);
             oset.emplace_back(ha);
         }
-        clock_t time_taken = clock() - t_begin;
+        clock_t time_taken = timerStop(t_begin);
         return timepair_t(time_taken,0);
     }
 
     if (2 == Nreserve)
     {
-        clock_t t_begin = clock();
+        clock_t t_begin = timerStart();
         for (unsigned int i = 0; i<Nclock; i++)
         {
             HandleSeq oset;
@@ -1794,13 +4975,13 @@ timepair_t AtomSpaceBenchmark::bm_emplace_back_reserve()
             oset.emplace_back(ha);
             oset.emplace_back(hb);
         }
-        clock_t time_taken = clock() - t_begin;
+        clock_t time_taken = timerStop(t_begin);
         return timepair_t(time_taken,0);
     }
 
     if (3 == Nreserve)
     {
-        clock_t t_begin = clock();
+        clock_t t_begin = timerStart();
         for (unsigned int i = 0; i<Nclock; i++)
         {
             HandleSeq oset;
@@ -1809,13 +4990,13 @@ timepair_t AtomSpaceBenchmark::bm_emplace_back_reserve()
             oset.emplace_back(hb);
             oset.emplace_back(hc);
         }
-        clock_t time_taken = clock() - t_begin;
+        clock_t time_taken = timerStop(t_begin);
         return timepair_t(time_taken,0);
     }
 
     if (4 == Nreserve)
     {
-        clock_t t_begin = clock();
+        clock_t t_begin = timerStart();
         for (unsigned int i = 0; i<Nclock; i++)
         {
             HandleSeq oset;
@@ -1825,7 +5006,7 @@ timepair_t AtomSpaceBenchmark::bm_emplace_back_reserve()
             oset.emplace_back(hc);
             oset.emplace_back(hd);
         }
-        clock_t time_taken = clock() - t_begin;
+        clock_t time_taken = timerStop(t_begin);
         return timepair_t(time_taken,0);
     }
 
@@ -1841,32 +5022,32 @@ timepair_t AtomSpaceBenchmark::bm_reserve()
 
     if (1 == Nreserve)
     {
-        clock_t t_begin = clock();
+        clock_t t_begin = timerStart();
         for (unsigned int i = 0; i<Nclock; i++)
         {
             HandleSeq oset(Nreserve);
             oset[0] = ha;
         }
-        clock_t time_taken = clock() - t_begin;
+        clock_t time_taken = timerStop(t_begin);
         return timepair_t(time_taken,0);
     }
 
     if (2 == Nreserve)
     {
-        clock_t t_begin = clock();
+        clock_t t_begin = timerStart();
         for (unsigned int i = 0; i<Nclock; i++)
         {
             HandleSeq oset(Nreserve);
             oset[0] = ha;
             oset[1] = hb;
         }
-        clock_t time_taken = clock() - t_begin;
+        clock_t time_taken = timerStop(t_begin);
         return timepair_t(time_taken,0);
     }
 
     if (3 == Nreserve)
     {
-        clock_t t_begin = clock();
+        clock_t t_begin = timerStart();
         for (unsigned int i = 0; i<Nclock; i++)
         {
             HandleSeq oset(Nreserve);
@@ -1874,13 +5055,13 @@ timepair_t AtomSpaceBenchmark::bm_reserve()
             oset[1] = hb;
             oset[2] = hc;
         }
-        clock_t time_taken = clock() - t_begin;
+        clock_t time_taken = timerStop(t_begin);
         return timepair_t(time_taken,0);
     }
 
     if (4 == Nreserve)
     {
-        clock_t t_begin = clock();
+        clock_t t_begin = timerStart();
         for (unsigned int i = 0; i<Nclock; i++)
         {
             HandleSeq oset(Nreserve);
@@ -1889,7 +5070,7 @@ timepair_t AtomSpaceBenchmark::bm_reserve()
             oset[2] = hc;
             oset[3] = hd;
         }
-        clock_t time_taken = clock() - t_begin;
+        clock_t time_taken = timerStop(t_begin);
         return timepair_t(time_taken,0);
     }
 
@@ -1930,13 +5111,38 @@ void AtomSpaceBenchmark::TimeStats::print()
     cout << "  std: " << t_std << endl;
 }
 
-void AtomSpaceBenchmark::recordToFile(std::ofstream& myfile, record_t record) const
+void AtomSpaceBenchmark::printLatency(const LatencyHistogram& hist)
+{
+    if (0 == hist.count())
+    {
+        cout << "No per-operation latencies recorded for this method" << endl;
+        return;
+    }
+    cout << "Per operation latency, in nanoseconds: " << endl;
+    cout << "  N: " << hist.count() << endl;
+    cout << "  mean: " << (uint64_t) hist.mean() << endl;
+    cout << "  p50: " << hist.percentile(50.0) << endl;
+    cout << "  p90: " << hist.percentile(90.0) << endl;
+    cout << "  p99: " << hist.percentile(99.0) << endl;
+    cout << "  p99.9: " << hist.percentile(99.9) << endl;
+    cout << "  max: " << hist.max() << endl;
+}
+
+void AtomSpaceBenchmark::printPerfCounters(const PerfCounters& pc, double nops)
 {
-    myfile << tuples::set_open(' ');
-    myfile << tuples::set_close(' ');
-    myfile << tuples::set_delimiter(',');
-    myfile << record;
-    myfile << "," << (float) get<1>(record) / CLOCKS_PER_SEC << endl;
+    if (pc.unscheduled())
+        cout << "Warning: the counter group could not always be scheduled\n";
+    cout << "Per operation hardware counters:" << endl;
+    for (int e = 0; e < PerfCounters::NUM_EVENTS; e++)
+    {
+        PerfCounters::Event ev = (PerfCounters::Event) e;
+        if (not pc.has(ev)) continue;
+        printf("  %s: %.2f\n", PerfCounters::name(ev), pc.value(ev) / nops);
+    }
+    if (pc.has(PerfCounters::CYCLES) and pc.has(PerfCounters::INSTRUCTIONS)
+        and 0.0 < pc.value(PerfCounters::CYCLES))
+        printf("  IPC: %.2f\n", pc.value(PerfCounters::INSTRUCTIONS)
+                                / pc.value(PerfCounters::CYCLES));
 }
 
 }
@@ -8,6 +8,16 @@
 
 #include <opencog/atomspace/AtomSpace.h>
 #include <opencog/atoms/atom_types/types.h>
+
+#include "AccessPattern.h"
+#include "BenchResults.h"
+#include "GraphShape.h"
+#include "LatencyHistogram.h"
+#include "LeafPool.h"
+#include "PerfCounters.h"
+#include "Snapshot.h"
+#include "SampleProfiler.h"
+#include "Trace.h"
 // #undef HAVE_CYTHON
 // #undef HAVE_GUILE
 
@@ -38,8 +48,16 @@ class AtomSpaceBenchmark
         void print();
     };
 
+    // Per-operation latencies of the current method; NULL unless
+    // perOpLatency is set.
+    LatencyHistogram* latencyHist;
+    void printLatency(const LatencyHistogram&);
 
-    void recordToFile(std::ofstream& file, const record_t record) const;
+    // Hardware counters around the timed regions of the current
+    // method; NULL unless hwCounters is set and they could be opened.
+    PerfCounters* perfCounters;
+    SampleProfiler* profiler;
+    void printPerfCounters(const PerfCounters&, double nops);
 
     float linkSize_mean;
 
@@ -74,7 +92,15 @@ class AtomSpaceBenchmark
 	clock_t makeRandomLinks();
 
     long getMemUsage();
-    int counter;
+    long counter;
+
+    // Heap bytes of the AtomTable indexes, per atom, as measured by
+    // measureAtomSizes(); zero until it has run.
+    double nodeIndexBytes;
+    double linkIndexBytes;
+    double incomingEntryBytes;
+    void measureAtomSizes();
+    void printTypeBreakdown(size_t heapBytes);
 
     // Obtain memoized or compiled variant of a guile expr
     std::string memoize_or_compile(std::string, std::string);
@@ -87,6 +113,105 @@ class AtomSpaceBenchmark
     unsigned int Nloops;
     int global;
 
+    // Number of workers running the current measurement. With one,
+    // the timed regions are measured in CPU time of the calling thread;
+    // with more, in wall-clock time, since the workers overlap.
+    int nThreads;
+    clock_t timerStart();
+    clock_t timerStop(clock_t t_begin);
+    clock_t readClock();
+
+    // Operation mix for bm_mix(), as set with setMix().
+    enum MixOp {
+        MIX_GET_TYPE, MIX_GET_TV, MIX_SET_TV, MIX_GET_INCOMING,
+        MIX_GET_INCOMING_SIZE, MIX_GET_OUTGOING, MIX_GET_VALUE,
+        MIX_SET_VALUE, MIX_ADD_NODE, MIX_ADD_LINK, MIX_REMOVE_ATOM,
+        NUM_MIX_OPS,
+        // Not drawn: a removeAtom that found the atom had gained an
+        // incoming link, or that got no atom, becomes this.
+        MIX_REMOVE_FAILED = NUM_MIX_OPS
+    };
+    struct MixStep {
+        MixOp op;
+        Type type;
+        Handle h;
+        float strength;
+        float conf;
+        std::string name;
+        HandleSeq oset;
+        Handle key;
+        std::vector<double> values;
+        uint64_t ns;
+    };
+    std::vector<double> mixWeights;
+    // Steps run of each operation, and with -H their latencies.
+    std::vector<uint64_t> mixCount;
+    std::vector<LatencyHistogram> mixHist;
+    MixOp randomMixOp();
+    void prepareMixStep(MixStep&);
+    void printMix(BenchResult&);
+    int runMixStep(MixStep&);
+    // Lookups by content for getNode, getLink and addNodeExisting: the
+    // type, and the name or outgoing set, of an atom that is there if
+    // hit, and of one that is not otherwise.
+    enum LookupKind { LOOKUP_NODE, LOOKUP_LINK, LOOKUP_ADD_NODE };
+    struct Lookup {
+        bool hit;
+        Type type;
+        std::string name;
+        HandleSeq oset;
+    };
+    // The lookups meant to miss (0) and to hit (1): how many, the
+    // nanoseconds they took together, how many found an atom, and,
+    // with -H, their latencies.
+    struct LookupGroup {
+        uint64_t count = 0;
+        uint64_t ns = 0;
+        uint64_t found = 0;
+        LatencyHistogram hist;
+        void reset() { count = ns = found = 0; hist.reset(); }
+        void merge(const LookupGroup& g)
+        {
+            count += g.count;
+            ns += g.ns;
+            found += g.found;
+            hist.merge(g.hist);
+        }
+    };
+    std::vector<LookupGroup> lookupGroups;
+    void prepareLookup(Lookup&, bool link);
+    Handle lookupOne(LookupKind, Lookup&);
+    timepair_t runLookups(LookupKind);
+    void printLookup(BenchResult&);
+
+    // Atoms visited by the scan methods, and the clock ticks the scans
+    // took.
+    uint64_t scanAtoms;
+    clock_t scanTicks;
+    std::vector<bool> scanParents;   // types that have subtypes
+    size_t atomsOfType(Type, bool subclass) const;
+    Type randomScanType(bool subclass);
+    timepair_t runScan(Type, bool subclass);
+    void printScan(BenchResult&);
+
+    // Keys for the getValue and setValue operations.
+    HandleSeq valueKeys;
+    Handle randomValueKey();
+
+    // Records the mix steps, with --record; shared by all workers.
+    TraceRecorder* recorder;
+    // The atoms removeAtom can pick from, when it is to be run; also
+    // shared by all workers.
+    LeafPool* leaves;
+    int workerIndex;
+    void recordMixStep(const MixStep&);
+    int replayStep(TraceStep&, ReplayTable&);
+
+    // Results of all methods so far, for the -j and --compare output.
+    std::vector<BenchResult> results;
+    RunInfo runInfo;
+    std::string apiName() const;
+
 public:
     unsigned int baseNclock;
     unsigned int baseNreps;
@@ -99,8 +224,74 @@ public:
     bool saveToFile;
     int saveInterval;
     bool doStats;
+    bool perOpLatency;
+    bool hwCounters;
+    bool memAccounting;
+
+    // Append one JSON record per method to this file, if not empty.
+    std::string jsonFile;
+    // Compare against the records in this file, if not empty.
+    std::string compareFile;
+    double compareAlpha;
+    // How often to run each method; 0 means 1, or 5 with compareFile.
+    int repetitions;
+    // Open-loop target rates (ops/sec) and seconds to run each; when
+    // set, the mix is run open-loop instead of the usual methods.
+    std::vector<double> openLoopRates;
+    double openLoopSeconds;
+    // Hub contention: every combination of these numbers of reader
+    // and writer threads and of hub atoms, for openLoopSeconds each,
+    // instead of the usual methods.
+    std::vector<int> hubReaders, hubWriters, hubCounts;
+    // Duplicate insertion: the percentages of atoms that all threads
+    // insert, one run each, instead of the usual methods.
+    std::vector<int> dupOverlaps;
+    // Fraction of the lookups of getNode, getLink and addNodeExisting
+    // that are for atoms that exist.
+    double lookupHitRatio;
+    // Threads that scanParallel splits the type index over.
+    int scanThreads;
+    // Shape of the incoming trees that removeAtomRecursive removes.
+    unsigned int rmTreeDepth;
+    unsigned int rmTreeFanout;
+    // Pick the batch size, warmup and number of batches automatically,
+    // stopping once the 95% interval is within autoCI of the mean.
+    bool autoCalibrate;
+    double autoCI;
+    double autoMaxSeconds;
+    // Subtract the measured cost of the clock reads and of the loop
+    // around each operation from single-threaded results.
+    bool subtractOverhead;
+    // Run the machine probes (MachineProbes.h) before the benchmarks.
+    bool runProbes;
     bool buildTestData;
     unsigned long randomseed;
+    // Threads to build the test atomspace with; with buildScaling,
+    // first report the build rate on 1, 2, 4 ... buildThreads threads.
+    int buildThreads;
+    bool buildScaling;
+    // Shape of the generated test atomspace; see GraphShape.h.
+    GraphShape graphShape;
+    ArityDistribution arity;
+    // Atomspace sizes to run the methods at, instead of atomCount.
+    std::vector<long> sweepSizes;
+    // With a prefix, sample the timed regions and write a folded-stack
+    // profile per method, to <prefix><method>.folded.
+    std::string profilePrefix;
+    int profileHz;
+    // Run each repetition of a method in a forked child: one that
+    // builds its own test atomspace on an untouched heap, or one that
+    // gets a copy-on-write copy of an atomspace built by the parent.
+    enum Isolation { ISOLATE_NONE, ISOLATE_CLEAN, ISOLATE_COW };
+    Isolation isolation;
+    // Record the operations of the -W mix to this file; or replay the
+    // operations recorded in it, instead of running the methods.
+    std::string recordFile;
+    std::string replayFile;
+    // Directory to keep snapshots of the test atomspace in, if any.
+    std::string snapshotDir;
+    // Which atoms the read methods pick; see AccessPattern.h.
+    AccessPattern accessPattern;
 
     enum BenchType { BENCH_AS = 1, BENCH_TABLE,
 #ifdef HAVE_GUILE
@@ -122,20 +313,27 @@ public:
 
     bool showTypeSizes;
     void printTypeSizes();
-    size_t estimateOfAtomSize(Handle h);
+    size_t estimateOfAtomSize(Handle h, bool recursive = true);
 
     AtomSpaceBenchmark();
     ~AtomSpaceBenchmark();
 
     void setMethod(std::string method);
     void showMethods();
-    void startBenchmark(int numThreads=1);
-    void doBenchmark(const std::string& methodName, BMFn methodToCall);
+    int startBenchmark(int numThreads=1);
+    BenchResult doBenchmark(const std::string& methodName, BMFn methodToCall);
 
     void buildAtomSpace(long atomspaceSize=(1 << 16), float percentLinks = 0.1, 
                         bool display = true);
     Handle getRandomHandle();
+    Handle getReadHandle();
     void setTestAllMethods() { setMethod("all"); }
+    bool setMix(const std::string& spec);
+    bool setRates(const std::string& spec);
+    bool setSizes(const std::string& spec);
+    bool setHubContention(const std::string& spec);
+    bool setDupOverlaps(const std::string& spec);
+    bool setRemoveTree(const std::string& spec);
 
     timepair_t bm_noop();
 
@@ -154,16 +352,83 @@ public:
     timepair_t bm_getIncomingSetSize();
     timepair_t bm_getOutgoingSet();
     timepair_t bm_getHandlesByType();
+    timepair_t bm_scanType();
+    timepair_t bm_scanSubclass();
+    timepair_t bm_scanParallel();
+    timepair_t bm_getNode();
+    timepair_t bm_getLink();
+    timepair_t bm_addNodeExisting();
+    timepair_t bm_mix();
 
     timepair_t bm_addNode();
     timepair_t bm_addLink();
     timepair_t bm_rmAtom();
+    timepair_t bm_rmAtomRecursive();
 
     timepair_t bm_push_back();
     timepair_t bm_push_back_reserve();
     timepair_t bm_emplace_back();
     timepair_t bm_emplace_back_reserve();
     timepair_t bm_reserve();
+
+private:
+    void setRepCounts(BMFn methodToCall);
+    bool usesLeaves(BMFn methodToCall) const;
+    void fillLeaves();
+    void setupAtomSpace();
+    void teardownAtomSpace();
+    std::string snapshotKey() const;
+    std::string snapshotPath() const;
+    bool restoreSnapshot();
+    void snapshotAtomSpace();
+    double generateAtomSpace();
+    size_t removeTreeSize() const;
+    void buildAtomSpaceParallel(long atomspaceSize, float percentLinks,
+                                int numThreads);
+    void runBuildScaling();
+    bool parallelBuild() const;
+    size_t randomArity();
+    Handle addGraphAtom(Type, std::string&&);
+    Handle addGraphAtom(Type, HandleSeq&&);
+    void buildGraph(long atomspaceSize, float percentLinks);
+    void buildZipfPairs(long atomspaceSize, HandleSeq& words, HandleSeq& pairs);
+    void runSizeSweep(int numThreads);
+    clock_t timerResolution();
+    // Cost of the timing itself, in clock ticks; see calibrateOverhead().
+    bool overheadCalibrated;
+    double overheadPerRegion;
+    double overheadPerOp;
+    clock_t emptyRegion(unsigned int n);
+    void calibrateOverhead();
+    double regionOverhead() const;
+    double netTicks(clock_t measured, double overhead) const;
+    void removeOverhead(BenchResult&, clock_t measured, double regions);
+    BenchResult doAutoBenchmark(const std::string& methodName,
+                                BMFn methodToCall);
+    BenchResult doThreadedBenchmark(const std::string& methodName,
+                                    BMFn methodToCall, int numThreads);
+    BenchResult repeatBenchmark(const std::string& methodName,
+                                BMFn methodToCall, int numThreads);
+    BenchResult runOnce(const std::string& methodName,
+                        BMFn methodToCall, int numThreads);
+    bool runIsolated(const std::string& methodName,
+                     BMFn methodToCall, int numThreads, int rep,
+                     const std::string& profileName, BenchResult&);
+    // Isolated runs that gave no result.
+    int failedRuns;
+    void recordResult(const BenchResult&);
+    // The samples of compareFile, by method.
+    std::map<std::string, std::vector<double>> baseline;
+    int compareWithBaseline();
+    AtomSpaceBenchmark* makeWorker(int t, int numThreads);
+    BenchResult doOpenLoop(double rate, int numThreads);
+    void runOpenLoop(int numThreads);
+    BenchResult doHubContention(int readers, int writers, int hubs);
+    void runHubContention();
+    BenchResult doDupInsert(int overlap, int numThreads, bool& ok);
+    int runDupInsert(int numThreads);
+    BenchResult doReplay(const Trace&, int numThreads);
+    bool runReplay(int numThreads);
 };
 
 } // namespace opencog
@@ -0,0 +1,437 @@
+/** BenchResults.cc */
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <fstream>
+#include <sstream>
+
+#include <unistd.h>
+
+#include "BenchResults.h"
+
+namespace opencog {
+
+BenchResult::BenchResult()
+    : threads(1), ops(0), wallSeconds(0.0), opsPerSec(0.0)
+{
+    latency.count = 0;
+    latency.mean = 0.0;
+    latency.p50 = latency.p90 = latency.p99 = latency.p999 = 0.0;
+    latency.max = 0.0;
+}
+
+void RunInfo::describeHost()
+{
+    char buf[256];
+    if (0 == gethostname(buf, sizeof(buf))) host = buf;
+
+    time_t now = time(NULL);
+    strftime(buf, sizeof(buf), "%Y-%m-%dT%H:%M:%SZ", gmtime(&now));
+    timestamp = buf;
+
+#if defined(__clang__)
+    compiler = "clang " __clang_version__;
+#elif defined(__GNUC__)
+    compiler = "gcc " __VERSION__;
+#else
+    compiler = "unknown";
+#endif
+
+    std::ifstream cpuinfo("/proc/cpuinfo");
+    std::string line;
+    while (std::getline(cpuinfo, line)) {
+        if (0 != line.compare(0, 10, "model name")) continue;
+        size_t colon = line.find(':');
+        if (std::string::npos != colon)
+            cpu = line.substr(line.find_first_not_of(" \t", colon + 1));
+        break;
+    }
+    unsigned int ncpu = std::max(1L, sysconf(_SC_NPROCESSORS_ONLN));
+    cpu += " (" + std::to_string(ncpu) + " cpus)";
+}
+
+// ================================================================
+// Writing
+
+static std::string quote(const std::string& s)
+{
+    std::string q = "\"";
+    for (char c : s) {
+        if ('"' == c or '\\' == c) { q += '\\'; q += c; }
+        else if ('\n' == c) q += "\\n";
+        else if ((unsigned char) c < 0x20) q += ' ';
+        else q += c;
+    }
+    return q + "\"";
+}
+
+static std::string number(double x, int digits = 17)
+{
+    if (not std::isfinite(x)) return "null";
+    char buf[32];
+    snprintf(buf, sizeof(buf), "%.*g", digits, x);
+    return buf;
+}
+
+static void writeMap(std::ostream& out, const std::map<std::string, double>& m)
+{
+    out << "{";
+    const char* sep = "";
+    for (const auto& kv : m) {
+        out << sep << quote(kv.first) << ":" << number(kv.second);
+        sep = ",";
+    }
+    out << "}";
+}
+
+void writeJson(std::ostream& out, const RunInfo& run, const BenchResult& res)
+{
+    out << "{\"method\":" << quote(res.method)
+        << ",\"api\":" << quote(res.api)
+        << ",\"threads\":" << res.threads
+        << ",\"ops_per_sec\":" << number(res.opsPerSec)
+        << ",\"samples\":[";
+    for (size_t i = 0; i < res.samples.size(); i++)
+        out << (i ? "," : "") << number(res.samples[i]);
+    out << "],\"ops\":" << res.ops
+        << ",\"wall_seconds\":" << number(res.wallSeconds);
+
+    if (res.latency.count) {
+        out << ",\"latency_ns\":{\"count\":" << res.latency.count
+            << ",\"mean\":" << number(res.latency.mean)
+            << ",\"p50\":" << number(res.latency.p50)
+            << ",\"p90\":" << number(res.latency.p90)
+            << ",\"p99\":" << number(res.latency.p99)
+            << ",\"p99.9\":" << number(res.latency.p999)
+            << ",\"max\":" << number(res.latency.max) << "}";
+    }
+    if (not res.counters.empty()) {
+        out << ",\"counters_per_op\":";
+        writeMap(out, res.counters);
+    }
+    for (const auto& kv : res.extra)
+        out << "," << quote(kv.first) << ":" << number(kv.second);
+
+    out << ",\"seed\":" << run.seed
+        << ",\"atom_count\":" << run.atomCount
+        << ",\"percent_links\":" << number(run.percentLinks, 6)
+        << ",\"nclock\":" << run.nclock
+        << ",\"nreps\":" << run.nreps
+        << ",\"access\":" << quote(run.access);
+    for (const auto& kv : run.extra)
+        out << "," << quote(kv.first) << ":" << number(kv.second);
+    if (not run.probes.empty()) {
+        out << ",\"probes\":";
+        writeMap(out, run.probes);
+    }
+    out << ",\"version\":" << quote(run.version)
+        << ",\"timestamp\":" << quote(run.timestamp)
+        << ",\"host\":" << quote(run.host)
+        << ",\"compiler\":" << quote(run.compiler)
+        << ",\"cpu\":" << quote(run.cpu)
+        << "}" << std::endl;
+}
+
+// ================================================================
+// Reading. Just enough of a JSON parser to get at the fields of the
+// records written above; nested objects are skipped over.
+
+namespace {
+
+struct Parser
+{
+    const std::string& s;
+    size_t pos;
+
+    Parser(const std::string& str) : s(str), pos(0) {}
+
+    void ws() { while (pos < s.size() and isspace(s[pos])) pos++; }
+    bool eat(char c)
+    {
+        ws();
+        if (pos < s.size() and s[pos] == c) { pos++; return true; }
+        return false;
+    }
+
+    bool string(std::string& out)
+    {
+        if (not eat('"')) return false;
+        out.clear();
+        while (pos < s.size() and s[pos] != '"') {
+            if ('\\' == s[pos] and pos + 1 < s.size()) pos++;
+            out += s[pos++];
+        }
+        return eat('"');
+    }
+
+    bool number(double& out)
+    {
+        ws();
+        if (0 == s.compare(pos, 4, "null")) {
+            pos += 4;
+            out = NAN;
+            return true;
+        }
+        const char* begin = s.c_str() + pos;
+        char* end;
+        out = strtod(begin, &end);
+        if (end == begin) return false;
+        pos += end - begin;
+        return true;
+    }
+
+    // Skip over any value.
+    bool skip()
+    {
+        ws();
+        if (pos >= s.size()) return false;
+        char c = s[pos];
+        std::string str;
+        double d;
+        if ('"' == c) return string(str);
+        if ('{' == c or '[' == c) {
+            char close = ('{' == c) ? '}' : ']';
+            pos++;
+            if (eat(close)) return true;
+            do {
+                if ('}' == close and not (string(str) and eat(':')))
+                    return false;
+                if (not skip()) return false;
+            } while (eat(','));
+            return eat(close);
+        }
+        if (0 == s.compare(pos, 4, "true") or 0 == s.compare(pos, 4, "null"))
+            { pos += 4; return true; }
+        if (0 == s.compare(pos, 5, "false")) { pos += 5; return true; }
+        return number(d);
+    }
+};
+
+} // anonymous namespace
+
+bool readSamples(const std::string& filename,
+                 std::map<std::string, std::vector<double>>& samples)
+{
+    std::ifstream in(filename);
+    if (not in) return false;
+
+    std::string line;
+    while (std::getline(in, line)) {
+        Parser p(line);
+        if (not p.eat('{')) continue;
+
+        std::string method, key;
+        double threads = 1;
+        std::vector<double> vals;
+        bool ok = true;
+        do {
+            if (not p.string(key) or not p.eat(':')) { ok = false; break; }
+            if ("method" == key) ok = p.string(method);
+            else if ("threads" == key) ok = p.number(threads);
+            else if ("samples" == key) {
+                ok = p.eat('[');
+                double d;
+                if (ok and not p.eat(']')) {
+                    do {
+                        ok = p.number(d);
+                        if (ok) vals.push_back(d);
+                    } while (ok and p.eat(','));
+                    ok = ok and p.eat(']');
+                }
+            }
+            else ok = p.skip();
+        } while (ok and p.eat(','));
+
+        if (not ok or method.empty()) continue;
+        if (1 != threads) method += "@" + std::to_string((int) threads);
+        std::vector<double>& dest = samples[method];
+        dest.insert(dest.end(), vals.begin(), vals.end());
+    }
+    return true;
+}
+
+// ================================================================
+// Passing results between processes
+
+// Unlike number(), keeps inf and nan, which strtod() reads back.
+static std::string exact(double x)
+{
+    char buf[32];
+    snprintf(buf, sizeof(buf), "%.17g", x);
+    return buf;
+}
+
+void writeResult(std::ostream& out, const BenchResult& res)
+{
+    out << "method " << res.method << "\n"
+        << "api " << res.api << "\n"
+        << "threads " << res.threads << "\n"
+        << "ops " << res.ops << "\n"
+        << "wall_seconds " << exact(res.wallSeconds) << "\n"
+        << "ops_per_sec " << exact(res.opsPerSec) << "\n";
+    for (double x : res.samples)
+        out << "sample " << exact(x) << "\n";
+    out << "latency " << res.latency.count
+        << " " << exact(res.latency.mean)
+        << " " << exact(res.latency.p50)
+        << " " << exact(res.latency.p90)
+        << " " << exact(res.latency.p99)
+        << " " << exact(res.latency.p999)
+        << " " << exact(res.latency.max) << "\n";
+    for (const auto& kv : res.counters)
+        out << "counter " << kv.first << " " << exact(kv.second) << "\n";
+    for (const auto& kv : res.extra)
+        out << "extra " << kv.first << " " << exact(kv.second) << "\n";
+    out << "end" << std::endl;
+}
+
+bool readResult(std::istream& in, BenchResult& res)
+{
+    res = BenchResult();
+    std::string line;
+    while (std::getline(in, line)) {
+        size_t sp = line.find(' ');
+        std::string key = line.substr(0, sp);
+        std::string val = std::string::npos == sp ? "" : line.substr(sp + 1);
+        std::istringstream vs(val);
+        if ("end" == key) return true;
+        else if ("method" == key) res.method = val;
+        else if ("api" == key) res.api = val;
+        else if ("threads" == key) res.threads = atoi(val.c_str());
+        else if ("ops" == key) res.ops = strtoul(val.c_str(), NULL, 10);
+        else if ("wall_seconds" == key) res.wallSeconds = strtod(val.c_str(), NULL);
+        else if ("ops_per_sec" == key) res.opsPerSec = strtod(val.c_str(), NULL);
+        else if ("sample" == key) res.samples.push_back(strtod(val.c_str(), NULL));
+        else if ("latency" == key) {
+            std::string f[7];
+            for (std::string& x : f) vs >> x;
+            res.latency.count = strtoul(f[0].c_str(), NULL, 10);
+            res.latency.mean = strtod(f[1].c_str(), NULL);
+            res.latency.p50 = strtod(f[2].c_str(), NULL);
+            res.latency.p90 = strtod(f[3].c_str(), NULL);
+            res.latency.p99 = strtod(f[4].c_str(), NULL);
+            res.latency.p999 = strtod(f[5].c_str(), NULL);
+            res.latency.max = strtod(f[6].c_str(), NULL);
+        }
+        else if ("counter" == key or "extra" == key) {
+            std::string name, x;
+            vs >> name >> x;
+            double d = strtod(x.c_str(), NULL);
+            if ("counter" == key) res.counters[name] = d;
+            else res.extra[name] = d;
+        }
+    }
+    return false;
+}
+
+// ================================================================
+// Statistics
+
+double median(std::vector<double> v)
+{
+    if (v.empty()) return 0.0;
+    std::sort(v.begin(), v.end());
+    size_t n = v.size();
+    return (n % 2) ? v[n/2] : 0.5 * (v[n/2 - 1] + v[n/2]);
+}
+
+double mean(const std::vector<double>& v)
+{
+    if (v.empty()) return 0.0;
+    double sum = 0.0;
+    for (double x : v) sum += x;
+    return sum / v.size();
+}
+
+// Two-sided 97.5% quantile of Student's t with df degrees of freedom.
+static double tQuantile(size_t df)
+{
+    static const double table[] = {
+        12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262,
+        2.228, 2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101,
+        2.093, 2.086, 2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052,
+        2.048, 2.045, 2.042
+    };
+    if (df <= 30) return table[df - 1];
+    // Close enough for larger samples.
+    return 1.960 + 2.4 / df;
+}
+
+double confidence95(const std::vector<double>& v)
+{
+    size_t n = v.size();
+    if (n < 2) return 0.0;
+    double m = mean(v);
+    double ss = 0.0;
+    for (double x : v) ss += (x - m) * (x - m);
+    return tQuantile(n - 1) * sqrt(ss / (n - 1) / n);
+}
+
+// Number of arrangements of m a's and n b's with exactly u pairs where
+// the a comes after the b; i.e. the null distribution of U.
+static double countU(int m, int n, int u,
+                     std::vector<std::vector<std::vector<double>>>& memo)
+{
+    if (u < 0) return 0.0;
+    if (0 == m or 0 == n) return (0 == u) ? 1.0 : 0.0;
+    double& c = memo[m][n][u];
+    if (0.0 <= c) return c;
+    c = countU(m - 1, n, u - n, memo) + countU(m, n - 1, u, memo);
+    return c;
+}
+
+double mannWhitney(const std::vector<double>& a, const std::vector<double>& b)
+{
+    size_t m = a.size(), n = b.size();
+    if (0 == m or 0 == n) return 1.0;
+
+    // Rank the pooled samples, averaging the ranks of ties.
+    std::vector<std::pair<double, int>> pooled;
+    for (double x : a) pooled.push_back({x, 0});
+    for (double x : b) pooled.push_back({x, 1});
+    std::sort(pooled.begin(), pooled.end());
+
+    double rankSumA = 0.0, tieTerm = 0.0;
+    bool ties = false;
+    for (size_t i = 0; i < pooled.size(); ) {
+        size_t j = i;
+        while (j < pooled.size() and pooled[j].first == pooled[i].first) j++;
+        double rank = 0.5 * (i + 1 + j);
+        for (size_t k = i; k < j; k++)
+            if (0 == pooled[k].second) rankSumA += rank;
+        double t = j - i;
+        if (1 < t) { ties = true; tieTerm += t*t*t - t; }
+        i = j;
+    }
+    double U = rankSumA - m * (m + 1) / 2.0;
+    double mean = m * n / 2.0;
+
+    // Exact distribution when small and without ties.
+    if (not ties and m + n <= 40) {
+        int umax = m * n;
+        std::vector<std::vector<std::vector<double>>> memo(m + 1,
+            std::vector<std::vector<double>>(n + 1,
+                std::vector<double>(umax + 1, -1.0)));
+        double total = 0.0, tail = 0.0;
+        double lo = std::min(U, umax - U);
+        for (int u = 0; u <= umax; u++) {
+            double c = countU(m, n, u, memo);
+            total += c;
+            if (u <= lo) tail += c;
+        }
+        return std::min(1.0, 2.0 * tail / total);
+    }
+
+    double N = m + n;
+    double var = m * n / 12.0 * ((N + 1) - tieTerm / (N * (N - 1)));
+    if (var <= 0.0) return 1.0;
+    // Continuity correction.
+    double z = (std::fabs(U - mean) - 0.5) / std::sqrt(var);
+    if (z < 0.0) z = 0.0;
+    return std::erfc(z / std::sqrt(2.0));
+}
+
+} // namespace opencog
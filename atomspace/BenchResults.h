@@ -0,0 +1,92 @@
+#ifndef _OPENCOG_BENCH_RESULTS_H
+#define _OPENCOG_BENCH_RESULTS_H
+
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace opencog
+{
+
+/**
+ * The outcome of benchmarking one method. Written out as one line of
+ * JSON per method (JSON Lines), so that results of many runs can be
+ * appended to one file, grepped and compared.
+ */
+struct BenchResult
+{
+    std::string method;
+    std::string api;
+    int threads;
+    unsigned long ops;           // operations per repetition
+    double wallSeconds;          // of the last repetition
+    double opsPerSec;            // median over the repetitions
+    std::vector<double> samples; // ops/sec, one per repetition
+
+    // Per-operation latency, in nanoseconds; count is zero without -H.
+    struct {
+        unsigned long count;
+        double mean;
+        double p50, p90, p99, p999, max;
+    } latency;
+
+    // Per-operation hardware counters; empty without -e.
+    std::map<std::string, double> counters;
+
+    // Anything else worth keeping, e.g. the heap change with -b.
+    std::map<std::string, double> extra;
+
+    BenchResult();
+};
+
+/// Facts about the run that every record carries.
+struct RunInfo
+{
+    std::string version;
+    std::string timestamp;
+    std::string host;
+    std::string compiler;
+    std::string cpu;
+    unsigned long seed;
+    long atomCount;
+    float percentLinks;
+    unsigned int nclock;
+    unsigned int nreps;
+    std::string access;          // read access pattern
+    std::map<std::string, double> extra;
+    std::map<std::string, double> probes;  // see MachineProbes.h
+
+    /// Fill in the host, compiler, CPU and time stamp.
+    void describeHost();
+};
+
+void writeJson(std::ostream&, const RunInfo&, const BenchResult&);
+
+/// Pass a result to another process (e.g. from a forked child) in a
+/// simple line-based form, "key value" per line, ending with "end".
+/// readResult() returns false if the stream ends before that.
+void writeResult(std::ostream&, const BenchResult&);
+bool readResult(std::istream&, BenchResult&);
+
+/// Read the ops/sec samples of each method from a file written by
+/// writeJson(). Keys are "method" for single-threaded results and
+/// "method@threads" otherwise. Returns false if the file is unreadable.
+bool readSamples(const std::string& filename,
+                 std::map<std::string, std::vector<double>>& samples);
+
+/// Two-sided p-value of the Mann-Whitney U test that a and b come from
+/// the same distribution. Exact for small samples, normal approximation
+/// (with tie correction) for larger ones.
+double mannWhitney(const std::vector<double>& a, const std::vector<double>& b);
+
+double median(std::vector<double> v);
+
+/// Mean of v, and the half-width of its 95% confidence interval
+/// (Student's t). The half-width is 0 for fewer than two values.
+double mean(const std::vector<double>& v);
+double confidence95(const std::vector<double>& v);
+
+} // namespace opencog
+
+#endif // _OPENCOG_BENCH_RESULTS_H
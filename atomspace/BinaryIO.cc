@@ -0,0 +1,45 @@
+/** BinaryIO.cc */
+
+#include "BinaryIO.h"
+
+namespace opencog {
+
+void putString(std::ostream& out, const std::string& s)
+{
+    put<uint32_t>(out, s.size());
+    out.write(s.data(), s.size());
+}
+
+bool BinaryReader::getString(std::string& s)
+{
+    uint32_t len;
+    if (not get(len) or not ok(len)) return false;
+    s.assign(_p, len);
+    _p += len;
+    return true;
+}
+
+void putTypeNames(std::ostream& out)
+{
+    Type ntypes = nameserver().getNumberOfClasses();
+    put<uint32_t>(out, ntypes);
+    for (Type t = 0; t < ntypes; t++)
+        putString(out, nameserver().getTypeName(t));
+}
+
+// The type numbers may differ between builds; go by name.
+bool getTypeNames(BinaryReader& in, std::vector<Type>& typeMap)
+{
+    uint32_t ntypes;
+    if (not in.get(ntypes)) return false;
+    typeMap.assign(ntypes, NOTYPE);
+    for (uint32_t t = 0; t < ntypes; t++)
+    {
+        std::string name;
+        if (not in.getString(name)) return false;
+        typeMap[t] = nameserver().getType(name);
+    }
+    return true;
+}
+
+} // namespace opencog
@@ -0,0 +1,59 @@
+#ifndef _OPENCOG_BINARY_IO_H
+#define _OPENCOG_BINARY_IO_H
+
+#include <cstdint>
+#include <cstring>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include <opencog/atoms/atom_types/types.h>
+
+namespace opencog
+{
+
+/**
+ * The binary encoding shared by snapshots and traces: values in host
+ * byte order, strings as a 32-bit length and the bytes, and the table
+ * of type names that the type numbers in the file refer to.
+ */
+
+template<typename T>
+void put(std::ostream& out, T value)
+{
+    out.write((const char*) &value, sizeof(T));
+}
+
+void putString(std::ostream&, const std::string&);
+
+/// Reads from a buffer, never past its end.
+class BinaryReader
+{
+    const char* _p;
+    const char* _end;
+public:
+    BinaryReader(const char* p, size_t len) : _p(p), _end(p + len) {}
+    bool ok(size_t n) const { return n <= (size_t) (_end - _p); }
+
+    template<typename T>
+    bool get(T& value)
+    {
+        if (not ok(sizeof(T))) return false;
+        memcpy(&value, _p, sizeof(T));
+        _p += sizeof(T);
+        return true;
+    }
+    bool getString(std::string&);
+};
+
+/// Write the names of all the types of this build.
+void putTypeNames(std::ostream&);
+
+/// Read the type names, and map each type number of the file to the
+/// type of that name in this build, or NOTYPE if it has none. False
+/// if the table is truncated.
+bool getTypeNames(BinaryReader&, std::vector<Type>& typeMap);
+
+} // namespace opencog
+
+#endif // _OPENCOG_BINARY_IO_H
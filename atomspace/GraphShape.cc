@@ -0,0 +1,171 @@
+/** GraphShape.cc */
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <sstream>
+
+#include "GraphShape.h"
+
+namespace opencog {
+
+GraphShape::GraphShape()
+    : _kind(UNIFORM), _a(0.57), _b(0.19), _c(0.19)
+{
+}
+
+bool GraphShape::parse(const std::string& spec)
+{
+    std::string name = spec.substr(0, spec.find(':'));
+    std::string args = (spec.find(':') == std::string::npos) ?
+                       "" : spec.substr(spec.find(':') + 1);
+    if (name == "uniform" and args.empty())
+        _kind = UNIFORM;
+    else if (name == "ba" and args.empty())
+        _kind = BARABASI_ALBERT;
+    else if (name == "zipf" and args.empty())
+        _kind = ZIPF_PAIRS;
+    else if (name == "rmat")
+    {
+        _kind = RMAT;
+        if (args.empty()) return true;
+        if (3 != sscanf(args.c_str(), "%lf,%lf,%lf", &_a, &_b, &_c))
+            return false;
+        if (_a < 0.0 or _b < 0.0 or _c < 0.0 or 1.0 < _a + _b + _c)
+            return false;
+    }
+    else return false;
+    return true;
+}
+
+std::string GraphShape::describe() const
+{
+    std::ostringstream oss;
+    switch (_kind)
+    {
+    case UNIFORM: return "uniform";
+    case BARABASI_ALBERT: return "ba";
+    case ZIPF_PAIRS: return "zipf";
+    case RMAT: oss << "rmat:" << _a << "," << _b << "," << _c; break;
+    }
+    return oss.str();
+}
+
+std::pair<size_t, size_t> GraphShape::rmatEdge(MT19937RandGen& rng,
+                                               size_t n) const
+{
+    int bits = 0;
+    while (((size_t) 1 << bits) < n) bits++;
+    while (true)
+    {
+        size_t src = 0, dst = 0;
+        for (int i = 0; i < bits; i++)
+        {
+            double p = rng.randdouble();
+            src <<= 1;
+            dst <<= 1;
+            if (p < _a) {}
+            else if (p < _a + _b) dst |= 1;
+            else if (p < _a + _b + _c) src |= 1;
+            else { src |= 1; dst |= 1; }
+        }
+        // Sizes that are not a power of two leave some cells empty.
+        if (src < n and dst < n) return std::make_pair(src, dst);
+    }
+}
+
+// ================================================================
+
+ArityDistribution::ArityDistribution()
+    : _kind(POISSON), _mean(2.0), _lo(1), _hi(1), _exponent(1.0)
+{
+}
+
+bool ArityDistribution::parse(const std::string& spec)
+{
+    std::string name = spec.substr(0, spec.find(':'));
+    std::string args = (spec.find(':') == std::string::npos) ?
+                       "" : spec.substr(spec.find(':') + 1);
+    unsigned long lo, hi;
+    if (name == "poisson")
+    {
+        _kind = POISSON;
+        _mean = args.empty() ? 2.0 : atof(args.c_str());
+        return 0.0 < _mean;
+    }
+    if (name == "fixed")
+    {
+        _kind = FIXED;
+        if (1 != sscanf(args.c_str(), "%lu", &lo) or 0 == lo) return false;
+        _lo = _hi = lo;
+        _mean = lo;
+        return true;
+    }
+    if (name == "uniform")
+    {
+        _kind = UNIFORM;
+        if (2 != sscanf(args.c_str(), "%lu:%lu", &lo, &hi)) return false;
+        if (0 == lo or hi < lo) return false;
+        _lo = lo;
+        _hi = hi;
+        _mean = 0.5 * (lo + hi);
+        return true;
+    }
+    if (name == "zipf")
+    {
+        _kind = ZIPF;
+        if (2 != sscanf(args.c_str(), "%lf:%lu", &_exponent, &hi)) return false;
+        if (_exponent < 0.0 or 0 == hi) return false;
+        _lo = 1;
+        _hi = hi;
+        // Arities are small; a table will do.
+        _cdf.clear();
+        double sum = 0.0, weighted = 0.0;
+        for (size_t k = 1; k <= hi; k++)
+        {
+            double w = pow((double) k, -_exponent);
+            sum += w;
+            weighted += k * w;
+            _cdf.push_back(sum);
+        }
+        for (double& c : _cdf) c /= sum;
+        _mean = weighted / sum;
+        return true;
+    }
+    return false;
+}
+
+std::string ArityDistribution::describe() const
+{
+    std::ostringstream oss;
+    switch (_kind)
+    {
+    case POISSON: oss << "poisson:" << _mean; break;
+    case FIXED: oss << "fixed:" << _lo; break;
+    case UNIFORM: oss << "uniform:" << _lo << ":" << _hi; break;
+    case ZIPF: oss << "zipf:" << _exponent << ":" << _hi; break;
+    }
+    return oss.str();
+}
+
+size_t ArityDistribution::sample(MT19937RandGen& rng) const
+{
+    switch (_kind)
+    {
+    case FIXED:
+        return _lo;
+    case UNIFORM:
+        return _lo + rng.randint(_hi - _lo + 1);
+    case ZIPF:
+    {
+        size_t k = 1 + (std::lower_bound(_cdf.begin(), _cdf.end(),
+                                         rng.randdouble()) - _cdf.begin());
+        return std::min(k, _hi);
+    }
+    default:
+        return 1;
+    }
+}
+
+} // namespace opencog
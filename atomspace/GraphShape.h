@@ -0,0 +1,84 @@
+#ifndef _OPENCOG_GRAPH_SHAPE_H
+#define _OPENCOG_GRAPH_SHAPE_H
+
+#include <cstddef>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <opencog/util/mt19937ar.h>
+
+namespace opencog
+{
+
+/**
+ * How the links of the test atomspace pick their outgoing atoms.
+ *
+ *   uniform             every node equally likely (the default)
+ *   ba                  Barabási–Albert preferential attachment: nodes
+ *                       arrive one at a time, and each new node links
+ *                       to older ones with probability proportional
+ *                       to their degree plus one; this makes hubs
+ *   rmat[:a,b,c]        R-MAT (Chakrabarti, Zhan and Faloutsos, 2004):
+ *                       each link is placed by recursively picking one
+ *                       of four quadrants of the adjacency matrix, with
+ *                       probabilities a, b, c and 1-a-b-c
+ *                       (default 0.57,0.19,0.19)
+ *   zipf                the word-pair model of micro/large_zipf_bm.cc:
+ *                       ListLinks of word pairs, with a Zipfian
+ *                       distribution of incoming sets
+ */
+class GraphShape
+{
+public:
+    enum Kind { UNIFORM, BARABASI_ALBERT, RMAT, ZIPF_PAIRS };
+
+    GraphShape();
+    bool parse(const std::string& spec);
+    std::string describe() const;
+    Kind kind() const { return _kind; }
+
+    /// An R-MAT link between two of n nodes, as indexes in [0, n).
+    std::pair<size_t, size_t> rmatEdge(MT19937RandGen&, size_t n) const;
+
+private:
+    Kind _kind;
+    double _a, _b, _c;
+};
+
+/**
+ * The number of atoms in the outgoing set of a generated link.
+ *
+ *   poisson:<mean>      Poisson, but at least one (the default, mean 2)
+ *   fixed:<k>           always k
+ *   uniform:<lo>:<hi>   equally likely from lo to hi
+ *   zipf:<s>:<max>      k from 1 to max, with probability
+ *                       proportional to 1/k^s
+ *
+ * The Poisson case is sampled by the caller, which keeps its own
+ * distribution for it.
+ */
+class ArityDistribution
+{
+public:
+    enum Kind { POISSON, FIXED, UNIFORM, ZIPF };
+
+    ArityDistribution();
+    bool parse(const std::string& spec);
+    std::string describe() const;
+    Kind kind() const { return _kind; }
+    double mean() const { return _mean; }
+
+    size_t sample(MT19937RandGen&) const;
+
+private:
+    Kind _kind;
+    double _mean;
+    size_t _lo, _hi;
+    double _exponent;
+    std::vector<double> _cdf;
+};
+
+} // namespace opencog
+
+#endif // _OPENCOG_GRAPH_SHAPE_H
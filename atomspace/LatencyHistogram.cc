@@ -0,0 +1,61 @@
+/** LatencyHistogram.cc */
+
+#include <algorithm>
+#include <cmath>
+
+#include "LatencyHistogram.h"
+
+namespace opencog {
+
+LatencyHistogram::LatencyHistogram()
+    : _counts(bucketIndex(UINT64_MAX) + 1, 0)
+{
+    reset();
+}
+
+void LatencyHistogram::reset()
+{
+    std::fill(_counts.begin(), _counts.end(), 0);
+    _total = 0;
+    _sum = 0;
+    _min = UINT64_MAX;
+    _max = 0;
+}
+
+// Largest value that lands in the bucket.
+uint64_t LatencyHistogram::bucketTop(size_t index)
+{
+    if (index < SUB_BUCKETS) return index;
+    int shift = index / HALF_BUCKETS - 1;
+    uint64_t mantissa = index - shift * HALF_BUCKETS;
+    return ((mantissa + 1) << shift) - 1;
+}
+
+void LatencyHistogram::merge(const LatencyHistogram& other)
+{
+    for (size_t i = 0; i < _counts.size(); i++)
+        _counts[i] += other._counts[i];
+    _total += other._total;
+    _sum += other._sum;
+    if (other._min < _min) _min = other._min;
+    if (_max < other._max) _max = other._max;
+}
+
+uint64_t LatencyHistogram::percentile(double pct) const
+{
+    if (0 == _total) return 0;
+    uint64_t rank = (uint64_t) std::ceil(pct / 100.0 * _total);
+    if (rank < 1) rank = 1;
+
+    uint64_t seen = 0;
+    for (size_t i = 0; i < _counts.size(); i++) {
+        seen += _counts[i];
+        if (rank <= seen) {
+            uint64_t top = bucketTop(i);
+            return top < _max ? top : _max;
+        }
+    }
+    return _max;
+}
+
+} // namespace opencog
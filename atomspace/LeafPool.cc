@@ -0,0 +1,50 @@
+/** LeafPool.cc */
+
+#include <utility>
+
+#include "LeafPool.h"
+
+namespace opencog {
+
+void LeafPool::clear()
+{
+    std::lock_guard<std::mutex> lck(_mtx);
+    _pool.clear();
+    _in.clear();
+}
+
+size_t LeafPool::size()
+{
+    std::lock_guard<std::mutex> lck(_mtx);
+    return _pool.size();
+}
+
+void LeafPool::offer(const Handle& h)
+{
+    if (0 < h->getIncomingSetSize()) return;
+    std::lock_guard<std::mutex> lck(_mtx);
+    if (_in.insert(h).second) _pool.push_back(h);
+}
+
+void LeafPool::removed(const Handle& h)
+{
+    if (not h->is_link()) return;
+    for (const Handle& o : h->getOutgoingSet()) offer(o);
+}
+
+Handle LeafPool::take(MT19937RandGen& rng)
+{
+    std::lock_guard<std::mutex> lck(_mtx);
+    while (not _pool.empty())
+    {
+        // Swap a random one to the end, and pop it.
+        std::swap(_pool[rng.randint(_pool.size())], _pool.back());
+        Handle h = _pool.back();
+        _pool.pop_back();
+        _in.erase(h);
+        if (0 == h->getIncomingSetSize()) return h;
+    }
+    return Handle::UNDEFINED;
+}
+
+} // namespace opencog
@@ -0,0 +1,46 @@
+#ifndef _OPENCOG_LEAF_POOL_H
+#define _OPENCOG_LEAF_POOL_H
+
+#include <mutex>
+#include <unordered_set>
+#include <vector>
+
+#include <opencog/util/mt19937ar.h>
+#include <opencog/atoms/base/Atom.h>
+
+namespace opencog
+{
+
+/**
+ * The atoms that removeAtom can remove: those without incoming links.
+ * Filled by scanning the test atomspace once, then kept up to date as
+ * atoms are added, and as removals turn the atoms of their outgoing
+ * sets into leaves; so that picking one is O(1), instead of retrying
+ * random atoms until one has no incoming set.
+ *
+ * An atom that gets an incoming link while in the pool is dropped when
+ * it is picked, and offered again once that link is removed. Shared by
+ * all workers; the calls are serialised.
+ */
+class LeafPool
+{
+    std::mutex _mtx;
+    std::vector<Handle> _pool;
+    std::unordered_set<Handle> _in;
+
+public:
+    void clear();
+    size_t size();
+
+    /// Add h if it has no incoming links, and is not in the pool yet.
+    void offer(const Handle&);
+    /// After h was removed: offer the atoms of its outgoing set.
+    void removed(const Handle&);
+    /// Take a random leaf out of the pool; Handle::UNDEFINED if there
+    /// is none left.
+    Handle take(MT19937RandGen&);
+};
+
+} // namespace opencog
+
+#endif // _OPENCOG_LEAF_POOL_H
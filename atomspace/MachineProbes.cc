@@ -0,0 +1,129 @@
+/** MachineProbes.cc */
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "LatencyHistogram.h"
+#include "MachineProbes.h"
+
+namespace opencog {
+
+// Keeps the compiler from optimising the probe loops away.
+static volatile uint64_t sink;
+
+static double chaseLatency()
+{
+    // One pointer per 64 byte line, linked in a single random cycle
+    // (Sattolo's shuffle), so the prefetchers cannot guess the next.
+    const size_t LINE = 64 / sizeof(size_t);
+    const size_t lines = (64 << 20) / 64;
+    std::vector<size_t> order(lines);
+    for (size_t i = 0; i < lines; i++) order[i] = i;
+    std::mt19937_64 rng(42);
+    for (size_t i = lines - 1; 0 < i; i--)
+        std::swap(order[i], order[rng() % i]);
+
+    std::vector<size_t> next(lines * LINE);
+    for (size_t i = 0; i < lines; i++)
+        next[order[i] * LINE] = order[(i + 1) % lines] * LINE;
+
+    const size_t loads = 4 << 20;
+    size_t p = 0;
+    uint64_t t0 = monotonic_ns();
+    for (size_t i = 0; i < loads; i++) p = next[p];
+    uint64_t t1 = monotonic_ns();
+    sink = p;
+    return (double) (t1 - t0) / loads;
+}
+
+static double streamBandwidth()
+{
+    const size_t n = (32 << 20) / sizeof(double);
+    std::vector<double> a(n, 0.0), b(n, 1.0), c(n, 2.0);
+    const double s = 3.0;
+    uint64_t best = UINT64_MAX;
+    for (int pass = 0; pass < 5; pass++)
+    {
+        uint64_t t0 = monotonic_ns();
+        for (size_t i = 0; i < n; i++) a[i] = b[i] + s * c[i];
+        best = std::min(best, monotonic_ns() - t0);
+    }
+    sink = a[n / 2];
+    return 3.0 * n * sizeof(double) / best;   // bytes per ns is GB/s
+}
+
+static double mallocRate()
+{
+    // Keep a few blocks alive, so that it is not always the same one.
+    const size_t ops = 1 << 20;
+    void* live[64] = {};
+    uint64_t t0 = monotonic_ns();
+    for (size_t i = 0; i < ops; i++)
+    {
+        void*& slot = live[i % 64];
+        free(slot);
+        slot = malloc(16 + 16 * (i % 16));
+    }
+    uint64_t t1 = monotonic_ns();
+    for (void* p : live) free(p);
+    return 1e9 * ops / (t1 - t0);
+}
+
+static double atomicRate(int nthreads)
+{
+    const size_t ops = (nthreads == 1 ? 10 : 2) << 20;
+    std::atomic<uint64_t> counter(0);
+    std::atomic<int> ready(0);
+    std::vector<std::thread> threads;
+    auto work = [&]()
+    {
+        // Start together, or the first thread runs uncontended.
+        ready++;
+        while (ready.load() < nthreads) std::this_thread::yield();
+        for (size_t i = 0; i < ops; i++) counter.fetch_add(1);
+    };
+
+    uint64_t t0 = monotonic_ns();
+    for (int t = 1; t < nthreads; t++) threads.push_back(std::thread(work));
+    work();
+    for (std::thread& t : threads) t.join();
+    uint64_t t1 = monotonic_ns();
+    sink = counter.load();
+    return 1e9 * ops * nthreads / (t1 - t0);
+}
+
+std::map<std::string, double> runMachineProbes()
+{
+    int ncores = std::min(8u, std::max(2u, std::thread::hardware_concurrency()));
+    std::map<std::string, double> probes;
+    probes["latency_ns"] = chaseLatency();
+    probes["stream_gb_per_sec"] = streamBandwidth();
+    probes["malloc_free_per_sec"] = mallocRate();
+    probes["atomic_inc_per_sec"] = atomicRate(1);
+    probes["atomic_contended_per_sec"] = atomicRate(ncores);
+    probes["atomic_contended_threads"] = ncores;
+    return probes;
+}
+
+void printMachineProbes(const std::map<std::string, double>& probes)
+{
+    printf("Machine probes:\n");
+    printf("  memory latency       %8.1f ns\n", probes.at("latency_ns"));
+    printf("  stream bandwidth     %8.2f GB/s\n",
+           probes.at("stream_gb_per_sec"));
+    printf("  malloc/free          %8.2f M/sec\n",
+           probes.at("malloc_free_per_sec") / 1e6);
+    printf("  atomic increment     %8.2f M/sec\n",
+           probes.at("atomic_inc_per_sec") / 1e6);
+    printf("  ... on %d threads     %8.2f M/sec\n\n",
+           (int) probes.at("atomic_contended_threads"),
+           probes.at("atomic_contended_per_sec") / 1e6);
+}
+
+} // namespace opencog
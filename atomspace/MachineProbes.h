@@ -0,0 +1,32 @@
+#ifndef _OPENCOG_MACHINE_PROBES_H
+#define _OPENCOG_MACHINE_PROBES_H
+
+#include <map>
+#include <string>
+
+namespace opencog
+{
+
+/**
+ * A short, fixed set of measurements of the host, run before the
+ * benchmarks, so that results from different machines can be
+ * normalised against them:
+ *
+ *   latency_ns              one load of a random pointer chase through
+ *                           64 MB, i.e. mostly a cache and TLB miss
+ *   stream_gb_per_sec       a[i] = b[i] + s * c[i] over three 32 MB
+ *                           arrays, best of five passes
+ *   malloc_free_per_sec     malloc/free pairs of 16 to 256 bytes
+ *   atomic_inc_per_sec      fetch_add on one counter, one thread
+ *   atomic_contended_per_sec  the same, on all cores (up to 8) at
+ *                           once; total over all threads
+ *
+ * Together they take about a second.
+ */
+std::map<std::string, double> runMachineProbes();
+
+void printMachineProbes(const std::map<std::string, double>&);
+
+} // namespace opencog
+
+#endif // _OPENCOG_MACHINE_PROBES_H
@@ -0,0 +1,141 @@
+/** PerfCounters.cc */
+
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "PerfCounters.h"
+
+namespace opencog {
+
+#define CACHE_MISS(CACHE) \
+    (PERF_COUNT_HW_CACHE_##CACHE | \
+     (PERF_COUNT_HW_CACHE_OP_READ << 8) | \
+     (PERF_COUNT_HW_CACHE_RESULT_MISS << 16))
+
+static const struct {
+    uint32_t type;
+    uint64_t config;
+    const char* name;
+} events[PerfCounters::NUM_EVENTS] = {
+    { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES, "cycles" },
+    { PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS, "instructions" },
+    { PERF_TYPE_HW_CACHE, CACHE_MISS(L1D), "L1d misses" },
+    { PERF_TYPE_HW_CACHE, CACHE_MISS(LL), "LLC misses" },
+    { PERF_TYPE_HW_CACHE, CACHE_MISS(DTLB), "dTLB misses" },
+    { PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES, "branch misses" },
+};
+
+static int perf_event_open(struct perf_event_attr* attr, int group_fd)
+{
+    // This thread only, on any CPU.
+    return syscall(__NR_perf_event_open, attr, 0, -1, group_fd, 0);
+}
+
+PerfCounters::PerfCounters()
+{
+    _leader = -1;
+    _nopen = 0;
+    for (int e = 0; e < NUM_EVENTS; e++) {
+        _fd[e] = -1;
+        _slot[e] = -1;
+    }
+    reset();
+
+    for (int e = 0; e < NUM_EVENTS; e++) {
+        struct perf_event_attr attr;
+        memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = events[e].type;
+        attr.config = events[e].config;
+        attr.disabled = (-1 == _leader);
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        attr.read_format = PERF_FORMAT_GROUP |
+            PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+        int fd = perf_event_open(&attr, _leader);
+        if (fd < 0) {
+            if (_error.empty()) {
+                _error = events[e].name;
+                _error += ": ";
+                _error += strerror(errno);
+            }
+            continue;
+        }
+        if (-1 == _leader) _leader = fd;
+        _fd[e] = fd;
+        _slot[e] = _nopen++;
+    }
+
+    if (0 == _nopen) {
+        std::ifstream paranoid("/proc/sys/kernel/perf_event_paranoid");
+        int level;
+        if (paranoid >> level) {
+            _error += " (kernel.perf_event_paranoid = ";
+            _error += std::to_string(level);
+            _error += ")";
+        }
+    }
+}
+
+PerfCounters::~PerfCounters()
+{
+    for (int e = 0; e < NUM_EVENTS; e++)
+        if (0 <= _fd[e]) close(_fd[e]);
+}
+
+void PerfCounters::reset()
+{
+    for (int e = 0; e < NUM_EVENTS; e++) _total[e] = 0.0;
+    _unscheduled = false;
+}
+
+void PerfCounters::start()
+{
+    if (-1 == _leader) return;
+    ioctl(_leader, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+    ioctl(_leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+}
+
+void PerfCounters::stop()
+{
+    if (-1 == _leader) return;
+    ioctl(_leader, PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+
+    // nr, time_enabled, time_running, then one value per event.
+    uint64_t buf[3 + NUM_EVENTS];
+    if (read(_leader, buf, sizeof(buf)) < (ssize_t) (3 * sizeof(uint64_t)))
+        return;
+
+    uint64_t enabled = buf[1];
+    uint64_t running = buf[2];
+    if (0 == running) {
+        if (0 < enabled) _unscheduled = true;
+        return;
+    }
+    double scale = (double) enabled / running;
+    for (int e = 0; e < NUM_EVENTS; e++)
+        if (0 <= _slot[e] and (uint64_t) _slot[e] < buf[0])
+            _total[e] += scale * buf[3 + _slot[e]];
+}
+
+void PerfCounters::merge(const PerfCounters& other)
+{
+    for (int e = 0; e < NUM_EVENTS; e++)
+        _total[e] += other._total[e];
+    _unscheduled = _unscheduled or other._unscheduled;
+}
+
+const char* PerfCounters::name(Event e)
+{
+    return events[e].name;
+}
+
+} // namespace opencog
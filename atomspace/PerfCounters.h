@@ -0,0 +1,71 @@
+#ifndef _OPENCOG_PERF_COUNTERS_H
+#define _OPENCOG_PERF_COUNTERS_H
+
+#include <string>
+
+namespace opencog
+{
+
+/**
+ * Hardware performance counters for the calling thread, opened with
+ * perf_event_open(2) as one group, so that all events are counted over
+ * exactly the same instructions. Only user-space is counted, so this
+ * works without root as long as kernel.perf_event_paranoid <= 2.
+ *
+ * Events that the CPU (or the virtual machine) does not support are
+ * skipped; if none can be opened, available() is false and error()
+ * says why.
+ */
+class PerfCounters
+{
+public:
+    enum Event {
+        CYCLES,
+        INSTRUCTIONS,
+        L1D_MISSES,
+        LLC_MISSES,
+        DTLB_MISSES,
+        BRANCH_MISSES,
+        NUM_EVENTS
+    };
+
+private:
+    int _fd[NUM_EVENTS];
+    int _leader;
+    int _nopen;
+    // Position of each open event in the group read buffer.
+    int _slot[NUM_EVENTS];
+    double _total[NUM_EVENTS];
+    bool _unscheduled;
+    std::string _error;
+
+public:
+    PerfCounters();
+    ~PerfCounters();
+
+    bool available() const { return 0 < _nopen; }
+    const std::string& error() const { return _error; }
+
+    /// Start and stop counting; counts accumulate across start/stop
+    /// pairs until reset().
+    void start();
+    void stop();
+    void reset();
+
+    /// Accumulate the counts of another set of counters (e.g. of
+    /// another thread) into this one.
+    void merge(const PerfCounters&);
+
+    bool has(Event e) const { return 0 <= _fd[e]; }
+    /// Count since reset(), scaled up if the kernel had to multiplex.
+    double value(Event e) const { return _total[e]; }
+    /// True if the group was never scheduled on the PMU, e.g. because
+    /// it needs more counters than the CPU has.
+    bool unscheduled() const { return _unscheduled; }
+
+    static const char* name(Event);
+};
+
+} // namespace opencog
+
+#endif // _OPENCOG_PERF_COUNTERS_H
@@ -0,0 +1,106 @@
+/** SampleRing.cc */
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "SampleRing.h"
+
+namespace opencog {
+
+static const char MAGIC[8] = { 'A', 'S', 'B', 'M', 'S', 'A', 'M', 'P' };
+static const uint32_t VERSION = 1;
+
+static bool writeAll(int fd, const void* buf, size_t len)
+{
+    const char* p = (const char*) buf;
+    while (0 < len)
+    {
+        ssize_t n = write(fd, p, len);
+        if (n < 0 and EINTR == errno) continue;
+        if (n <= 0) return false;
+        p += n;
+        len -= n;
+    }
+    return true;
+}
+
+SampleRing::SampleRing(const std::string& path, size_t capacity,
+                       double ticksPerSecond)
+    : _head(0), _tail(0), _done(false), _dropped(0), _written(0)
+{
+    size_t size = 1024;
+    while (size < capacity) size <<= 1;
+    // Value-initialised, so the pages are touched before measuring.
+    _ring.resize(size);
+    _mask = size - 1;
+
+    _fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (_fd < 0)
+    {
+        _error = path + ": " + strerror(errno);
+        return;
+    }
+    char header[24];
+    uint32_t recordSize = sizeof(Sample);
+    memcpy(header, MAGIC, 8);
+    memcpy(header + 8, &VERSION, 4);
+    memcpy(header + 12, &recordSize, 4);
+    memcpy(header + 16, &ticksPerSecond, 8);
+    if (not writeAll(_fd, header, sizeof(header)))
+    {
+        _error = path + ": " + strerror(errno);
+        ::close(_fd);
+        _fd = -1;
+        return;
+    }
+    _writer = std::thread(&SampleRing::drain, this);
+}
+
+SampleRing::~SampleRing()
+{
+    close();
+}
+
+void SampleRing::drain()
+{
+    while (true)
+    {
+        // Read the flag first: every push before close() is then seen.
+        bool done = _done.load(std::memory_order_acquire);
+        size_t head = _head.load(std::memory_order_acquire);
+        size_t tail = _tail.load(std::memory_order_relaxed);
+        if (head == tail)
+        {
+            if (done) return;
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            continue;
+        }
+        // Up to the end of the buffer; the rest comes next time round.
+        size_t start = tail & _mask;
+        size_t n = std::min(head - tail, _ring.size() - start);
+        if (not writeAll(_fd, &_ring[start], n * sizeof(Sample)))
+        {
+            _error = strerror(errno);
+            _tail.store(head, std::memory_order_release);
+            continue;
+        }
+        _written += n;
+        _tail.store(tail + n, std::memory_order_release);
+    }
+}
+
+void SampleRing::close()
+{
+    if (not _writer.joinable()) return;
+    _done.store(true, std::memory_order_release);
+    _writer.join();
+    ::close(_fd);
+    _fd = -1;
+}
+
+} // namespace opencog
@@ -0,0 +1,84 @@
+#ifndef _OPENCOG_SAMPLE_RING_H
+#define _OPENCOG_SAMPLE_RING_H
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace opencog
+{
+
+/**
+ * Per-operation samples recorded with -f. The measuring thread only
+ * copies each sample into a preallocated single-producer ring buffer;
+ * a background thread drains the ring with write(2) into a binary file.
+ * So nothing is formatted, nothing is allocated and no system call is
+ * made in the measurement loop, and the heap numbers are undisturbed.
+ *
+ * When the writer falls behind and the ring is full, samples are
+ * dropped (and counted) rather than making the measurement wait.
+ *
+ * The file is a 24-byte header: "ASBMSAMP", a uint32 version, the
+ * uint32 size of a record and the double ticks per second; then one
+ * Sample per record, in host byte order.
+ */
+class SampleRing
+{
+public:
+    struct Sample
+    {
+        uint64_t atomspaceSize;
+        int64_t ticks;
+        // Change of the live heap, in KB.
+        int64_t heapDelta;
+    };
+
+private:
+    std::vector<Sample> _ring;
+    size_t _mask;
+    std::atomic<size_t> _head;
+    std::atomic<size_t> _tail;
+    std::atomic<bool> _done;
+    size_t _dropped;
+    size_t _written;
+    int _fd;
+    std::string _error;
+    std::thread _writer;
+
+    void drain();
+
+public:
+    // The capacity is rounded up to a power of two.
+    SampleRing(const std::string& path, size_t capacity,
+               double ticksPerSecond);
+    ~SampleRing();
+
+    bool ok() const { return 0 <= _fd; }
+    const std::string& error() const { return _error; }
+
+    void push(uint64_t atomspaceSize, int64_t ticks, int64_t heapDelta)
+    {
+        size_t head = _head.load(std::memory_order_relaxed);
+        if (head - _tail.load(std::memory_order_acquire) > _mask)
+        {
+            _dropped++;
+            return;
+        }
+        Sample& s = _ring[head & _mask];
+        s.atomspaceSize = atomspaceSize;
+        s.ticks = ticks;
+        s.heapDelta = heapDelta;
+        _head.store(head + 1, std::memory_order_release);
+    }
+
+    /// Write out what is left and close the file.
+    void close();
+    size_t written() const { return _written; }
+    size_t dropped() const { return _dropped; }
+};
+
+} // namespace opencog
+
+#endif // _OPENCOG_SAMPLE_RING_H
@@ -0,0 +1,187 @@
+/** Snapshot.cc */
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <unordered_map>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <opencog/atoms/atom_types/types.h>
+#include <opencog/atoms/truthvalue/SimpleTruthValue.h>
+
+#include "BinaryIO.h"
+#include "Snapshot.h"
+
+namespace opencog {
+
+// Bump the version whenever the layout changes.
+static const char MAGIC[8] = { 'A', 'S', 'B', 'M', 'S', 'N', 'A', 'P' };
+static const uint32_t VERSION = 1;
+
+enum : uint8_t { IS_LINK = 1, HAS_TV = 2 };
+
+// Number the atoms so that every atom comes after its outgoing set.
+static void number(const Handle& h, std::unordered_map<Handle, uint32_t>& index,
+                   HandleSeq& order)
+{
+    if (index.count(h)) return;
+    if (h->is_link())
+        for (const Handle& o : h->getOutgoingSet())
+            number(o, index, order);
+    index[h] = order.size();
+    order.push_back(h);
+}
+
+bool writeSnapshot(const std::string& path, const SnapshotInfo& info,
+                   const HandleSeq& atoms)
+{
+    std::unordered_map<Handle, uint32_t> index;
+    HandleSeq order;
+    order.reserve(atoms.size());
+    for (const Handle& h : atoms)
+        if (not h->is_link()) number(h, index, order);
+    for (const Handle& h : atoms)
+        if (h->is_link()) number(h, index, order);
+
+    // Write to a temporary and rename, so that an interrupted run
+    // doesn't leave a truncated snapshot behind.
+    std::string tmp = path + ".tmp";
+    std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+    if (not out) return false;
+
+    out.write(MAGIC, sizeof(MAGIC));
+    put<uint32_t>(out, VERSION);
+    putString(out, info.key);
+    put<double>(out, info.buildSeconds);
+    put<int64_t>(out, info.counter);
+
+    putTypeNames(out);
+
+    put<uint64_t>(out, order.size());
+    for (const Handle& h : order)
+    {
+        TruthValuePtr tv = h->getTruthValue();
+        bool hasTV = (tv != TruthValue::DEFAULT_TV());
+        put<uint16_t>(out, h->get_type());
+        put<uint8_t>(out, (h->is_link() ? IS_LINK : 0) | (hasTV ? HAS_TV : 0));
+        if (hasTV)
+        {
+            put<float>(out, tv->get_mean());
+            put<float>(out, tv->get_confidence());
+        }
+        if (h->is_link())
+        {
+            const HandleSeq& oset = h->getOutgoingSet();
+            put<uint32_t>(out, oset.size());
+            for (const Handle& o : oset) put<uint32_t>(out, index[o]);
+        }
+        else putString(out, h->get_name());
+    }
+    out.close();
+    if (not out) return false;
+    return 0 == rename(tmp.c_str(), path.c_str());
+}
+
+// With no adders, only checks that the atoms can all be added: that the
+// file is whole, and that this build has all of their types.
+static bool readAtoms(BinaryReader& in, SnapshotInfo& info, const NodeAdder& addNode,
+                      const LinkAdder& addLink, HandleSeq& added)
+{
+    bool adding = addNode and addLink;
+    char magic[sizeof(MAGIC)];
+    uint32_t version;
+    std::string key;
+    for (char& c : magic) if (not in.get(c)) return false;
+    if (memcmp(magic, MAGIC, sizeof(MAGIC))) return false;
+    if (not in.get(version) or VERSION != version) return false;
+    if (not in.getString(key) or key != info.key) return false;
+
+    int64_t counter;
+    if (not in.get(info.buildSeconds) or not in.get(counter)) return false;
+    info.counter = counter;
+
+    std::vector<Type> typeMap;
+    if (not getTypeNames(in, typeMap)) return false;
+
+    uint64_t natoms;
+    if (not in.get(natoms)) return false;
+    HandleSeq atoms;
+    if (adding) atoms.reserve(natoms);
+    for (uint64_t i = 0; i < natoms; i++)
+    {
+        uint16_t t;
+        uint8_t flags;
+        if (not in.get(t) or not in.get(flags) or typeMap.size() <= t) return false;
+        // A type that this build does not have, or has as the other kind.
+        bool link = (flags & IS_LINK);
+        if (NOTYPE == typeMap[t] or
+            link != nameserver().isA(typeMap[t], LINK)) return false;
+        float mean = 0.0, conf = 0.0;
+        if ((flags & HAS_TV) and not (in.get(mean) and in.get(conf)))
+            return false;
+
+        Handle h;
+        if (link)
+        {
+            uint32_t arity;
+            if (not in.get(arity)) return false;
+            HandleSeq oset(adding ? arity : 0);
+            for (uint32_t k = 0; k < arity; k++)
+            {
+                uint32_t j;
+                if (not in.get(j) or i <= j) return false;
+                if (adding) oset[k] = atoms[j];
+            }
+            if (adding) h = addLink(typeMap[t], std::move(oset));
+        }
+        else
+        {
+            std::string name;
+            if (not in.getString(name)) return false;
+            if (adding) h = addNode(typeMap[t], std::move(name));
+        }
+        if (not adding) continue;
+        if (flags & HAS_TV)
+            h->setTruthValue(SimpleTruthValue::createTV(mean, conf));
+        atoms.push_back(h);
+    }
+    info.atoms = natoms;
+    if (not adding) return true;
+    added.insert(added.end(), atoms.begin(), atoms.end());
+    return true;
+}
+
+bool readSnapshot(const std::string& path, SnapshotInfo& info,
+                  const NodeAdder& addNode, const LinkAdder& addLink,
+                  HandleSeq& added)
+{
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+    struct stat st;
+    if (fstat(fd, &st) < 0 or 0 == st.st_size)
+    {
+        close(fd);
+        return false;
+    }
+    void* map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (MAP_FAILED == map) return false;
+    madvise(map, st.st_size, MADV_SEQUENTIAL);
+
+    // Check the whole file first, so that a bad one adds nothing.
+    BinaryReader check((const char*) map, st.st_size);
+    bool ok = readAtoms(check, info, NodeAdder(), LinkAdder(), added);
+    if (ok)
+    {
+        BinaryReader in((const char*) map, st.st_size);
+        ok = readAtoms(in, info, addNode, addLink, added);
+    }
+    munmap(map, st.st_size);
+    return ok;
+}
+
+} // namespace opencog
@@ -0,0 +1,46 @@
+#ifndef _OPENCOG_SNAPSHOT_H
+#define _OPENCOG_SNAPSHOT_H
+
+#include <functional>
+#include <string>
+
+#include <opencog/atoms/base/Atom.h>
+
+namespace opencog
+{
+
+/**
+ * Binary snapshot of a generated test AtomSpace, so that big test
+ * AtomSpaces need be generated only once.
+ *
+ * The file holds the type names, then every atom: its type, its
+ * truth value (if not the default), and its name or the indexes of
+ * its outgoing atoms, which always come before it. The key describes
+ * the seed and parameters that the atoms were generated from; a
+ * snapshot is only used if the key matches.
+ */
+struct SnapshotInfo
+{
+    std::string key;
+    double buildSeconds;   // how long generating the atoms took
+    long counter;          // node name counter after generating them
+    size_t atoms;
+};
+
+typedef std::function<Handle(Type, std::string&&)> NodeAdder;
+typedef std::function<Handle(Type, HandleSeq&&)> LinkAdder;
+
+/// Write the atoms, and everything they point to. False on failure.
+bool writeSnapshot(const std::string& path, const SnapshotInfo&,
+                   const HandleSeq& atoms);
+
+/// Memory-map the snapshot at path and add its atoms in one sweep,
+/// appending them to added. Returns false, before adding anything,
+/// if there is no such file, its key is not info.key, it is truncated,
+/// or it has atoms of a type that this build does not have.
+bool readSnapshot(const std::string& path, SnapshotInfo& info,
+                  const NodeAdder&, const LinkAdder&, HandleSeq& added);
+
+} // namespace opencog
+
+#endif // _OPENCOG_SNAPSHOT_H
@@ -0,0 +1,258 @@
+/** Trace.cc */
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <iterator>
+
+#include <opencog/atoms/atom_types/types.h>
+#include <opencog/atoms/truthvalue/TruthValue.h>
+
+#include "BinaryIO.h"
+#include "Trace.h"
+
+namespace opencog {
+
+// Magic and layout version of trace files.
+static const char MAGIC[8] = { 'A', 'S', 'B', 'M', 'T', 'R', 'C', 'E' };
+static const uint32_t VERSION = 1;
+
+static const char* opNames[] = {
+    "end", "defineNode", "defineLink", "addNode", "addLink", "removeAtom",
+    "getType", "getTV", "setTV", "getValue", "setValue", "getIncomingSet",
+    "getIncomingSetSize", "getOutgoingSet"
+};
+
+const char* traceOpName(TraceOp op)
+{
+    return op < NUM_TRACE_OPS ? opNames[op] : "unknown";
+}
+
+// ================================================================
+// Recording
+
+TraceRecorder::TraceRecorder(const std::string& path)
+    : _out(path, std::ios::binary | std::ios::trunc), _steps(0)
+{
+    if (not _out)
+    {
+        _error = path + ": " + strerror(errno);
+        return;
+    }
+    _out.write(MAGIC, sizeof(MAGIC));
+    put<uint32_t>(_out, VERSION);
+    putTypeNames(_out);
+}
+
+void TraceRecorder::step(TraceOp op, uint8_t thread, uint32_t atom)
+{
+    put<uint8_t>(_out, op);
+    put<uint8_t>(_out, thread);
+    put<uint32_t>(_out, atom);
+    _steps++;
+}
+
+// Type, then the name or the ordinals of the outgoing set, which must
+// already have been written.
+void TraceRecorder::atomBody(const Handle& h)
+{
+    put<uint16_t>(_out, h->get_type());
+    if (h->is_link())
+    {
+        const HandleSeq& oset = h->getOutgoingSet();
+        put<uint32_t>(_out, oset.size());
+        for (const Handle& o : oset) put<uint32_t>(_out, _ordinal[o]);
+    }
+    else putString(_out, h->get_name());
+}
+
+// The ordinal of h; an atom seen for the first time existed before
+// the trace, and is defined, after its outgoing set.
+uint32_t TraceRecorder::ordinal(const Handle& h, uint8_t thread)
+{
+    auto it = _ordinal.find(h);
+    if (it != _ordinal.end()) return it->second;
+
+    if (h->is_link())
+        for (const Handle& o : h->getOutgoingSet()) ordinal(o, thread);
+    uint32_t ord = _ordinal.size();
+    _ordinal[h] = ord;
+
+    TruthValuePtr tv = h->getTruthValue();
+    step(h->is_link() ? TRACE_DEFINE_LINK : TRACE_DEFINE_NODE, thread, ord);
+    put<float>(_out, tv->get_mean());
+    put<float>(_out, tv->get_confidence());
+    atomBody(h);
+    return ord;
+}
+
+void TraceRecorder::access(TraceOp op, int thread, const Handle& h)
+{
+    std::lock_guard<std::mutex> lck(_mtx);
+    step(op, thread, ordinal(h, thread));
+}
+
+void TraceRecorder::added(int thread, const Handle& h)
+{
+    std::lock_guard<std::mutex> lck(_mtx);
+    if (h->is_link())
+        for (const Handle& o : h->getOutgoingSet()) ordinal(o, thread);
+    // Not ordinal(): the atom was made by this step, not before it.
+    auto it = _ordinal.find(h);
+    uint32_t ord = _ordinal.size();
+    if (it == _ordinal.end()) _ordinal[h] = ord;
+    else ord = it->second;
+
+    step(h->is_link() ? TRACE_ADD_LINK : TRACE_ADD_NODE, thread, ord);
+    atomBody(h);
+}
+
+void TraceRecorder::setTV(int thread, const Handle& h,
+                          float strength, float conf)
+{
+    std::lock_guard<std::mutex> lck(_mtx);
+    step(TRACE_SET_TV, thread, ordinal(h, thread));
+    put<float>(_out, strength);
+    put<float>(_out, conf);
+}
+
+void TraceRecorder::getValue(int thread, const Handle& h, const Handle& key)
+{
+    std::lock_guard<std::mutex> lck(_mtx);
+    uint32_t k = ordinal(key, thread);
+    step(TRACE_GET_VALUE, thread, ordinal(h, thread));
+    put<uint32_t>(_out, k);
+}
+
+void TraceRecorder::setValue(int thread, const Handle& h, const Handle& key,
+                             const std::vector<double>& values)
+{
+    std::lock_guard<std::mutex> lck(_mtx);
+    uint32_t k = ordinal(key, thread);
+    step(TRACE_SET_VALUE, thread, ordinal(h, thread));
+    put<uint32_t>(_out, k);
+    put<uint32_t>(_out, values.size());
+    for (double v : values) put<double>(_out, v);
+}
+
+size_t TraceRecorder::close()
+{
+    std::lock_guard<std::mutex> lck(_mtx);
+    if (not _out.is_open()) return _steps;
+    put<uint8_t>(_out, TRACE_END);
+    _out.close();
+    if (not _out and _error.empty()) _error = "write error";
+    return _steps;
+}
+
+// ================================================================
+// Reading
+
+static bool readBody(BinaryReader& in, TraceStep& st, bool link,
+                     const std::vector<Type>& typeMap, uint32_t known)
+{
+    uint16_t t;
+    if (not in.get(t) or typeMap.size() <= t) return false;
+    st.type = typeMap[t];
+    if (not link) return in.getString(st.name);
+
+    uint32_t arity;
+    if (not in.get(arity) or not in.ok(4 * (size_t) arity)) return false;
+    st.oset.resize(arity);
+    for (uint32_t& o : st.oset)
+        if (not in.get(o) or known <= o) return false;
+    return true;
+}
+
+bool readTrace(const std::string& path, Trace& trace, std::string& error)
+{
+    std::ifstream file(path, std::ios::binary);
+    if (not file)
+    {
+        error = path + ": " + strerror(errno);
+        return false;
+    }
+    std::string data((std::istreambuf_iterator<char>(file)),
+                     std::istreambuf_iterator<char>());
+    BinaryReader in(data.data(), data.size());
+    error = path + ": not a trace, or truncated";
+
+    char magic[sizeof(MAGIC)];
+    uint32_t version;
+    for (char& c : magic) if (not in.get(c)) return false;
+    if (memcmp(magic, MAGIC, sizeof(MAGIC))) return false;
+    if (not in.get(version) or VERSION != version)
+    {
+        error = path + ": unsupported trace version";
+        return false;
+    }
+
+    std::vector<Type> typeMap;
+    if (not getTypeNames(in, typeMap)) return false;
+
+    trace.setup.clear();
+    trace.steps.clear();
+    trace.atoms = 0;
+    trace.threads = 1;
+    for (size_t& c : trace.count) c = 0;
+    while (true)
+    {
+        uint8_t op;
+        if (not in.get(op) or NUM_TRACE_OPS <= op) return false;
+        if (TRACE_END == op) break;
+
+        TraceStep st = TraceStep();
+        st.op = (TraceOp) op;
+        if (not in.get(st.thread) or not in.get(st.atom)) return false;
+        // A step can only refer to ordinals that came before it, or
+        // (for DEFINE and ADD) the next one.
+        bool creates = (TRACE_DEFINE_NODE <= op and op <= TRACE_ADD_LINK);
+        if (trace.atoms < st.atom or (trace.atoms == st.atom and not creates))
+            return false;
+        uint32_t known = trace.atoms;
+        if (trace.atoms == st.atom) trace.atoms++;
+
+        bool ok = true;
+        switch (st.op)
+        {
+        case TRACE_DEFINE_NODE:
+        case TRACE_DEFINE_LINK:
+            ok = in.get(st.strength) and in.get(st.conf) and
+                 readBody(in, st, TRACE_DEFINE_LINK == op, typeMap, known);
+            break;
+        case TRACE_ADD_NODE:
+        case TRACE_ADD_LINK:
+            ok = readBody(in, st, TRACE_ADD_LINK == op, typeMap, known);
+            break;
+        case TRACE_SET_TV:
+            ok = in.get(st.strength) and in.get(st.conf);
+            break;
+        case TRACE_GET_VALUE:
+            ok = in.get(st.key) and st.key < trace.atoms;
+            break;
+        case TRACE_SET_VALUE: {
+            uint32_t n;
+            ok = in.get(st.key) and st.key < trace.atoms and in.get(n) and
+                 in.ok(8 * (size_t) n);
+            if (not ok) break;
+            st.values.resize(n);
+            for (double& v : st.values) in.get(v);
+            break;
+        }
+        default:
+            break;
+        }
+        if (not ok) return false;
+
+        trace.count[op]++;
+        trace.threads = std::max(trace.threads, st.thread + 1);
+        if (TRACE_DEFINE_NODE == op or TRACE_DEFINE_LINK == op)
+            trace.setup.push_back(std::move(st));
+        else
+            trace.steps.push_back(std::move(st));
+    }
+    error.clear();
+    return true;
+}
+
+} // namespace opencog
@@ -0,0 +1,150 @@
+#ifndef _OPENCOG_TRACE_H
+#define _OPENCOG_TRACE_H
+
+#include <atomic>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include <opencog/atoms/base/Atom.h>
+
+namespace opencog
+{
+
+/**
+ * Traces of AtomSpace operations, so that two builds can run exactly
+ * the same sequence of calls.
+ *
+ * Atoms are referred to by ordinal: the number of the atom in the
+ * order the trace first mentions it. An atom that already existed
+ * when it was first mentioned gets a DEFINE step, with its type, truth
+ * value and name or outgoing set; these are replayed first, untimed.
+ * Every other step only refers to ordinals that an earlier step (in
+ * the order of the file) defined or added, so the trace can also be
+ * replayed on several threads, each thread waiting for the ordinals
+ * that another one has yet to add.
+ *
+ * The file holds the type names, then the steps: the op, the number
+ * of the recording thread and the ordinal of the atom, followed by
+ * whatever else the op needs.
+ */
+enum TraceOp : uint8_t
+{
+    TRACE_END,
+    TRACE_DEFINE_NODE,
+    TRACE_DEFINE_LINK,
+    TRACE_ADD_NODE,
+    TRACE_ADD_LINK,
+    TRACE_REMOVE,
+    TRACE_GET_TYPE,
+    TRACE_GET_TV,
+    TRACE_SET_TV,
+    TRACE_GET_VALUE,
+    TRACE_SET_VALUE,
+    TRACE_GET_INCOMING,
+    TRACE_GET_INCOMING_SIZE,
+    TRACE_GET_OUTGOING,
+    NUM_TRACE_OPS
+};
+
+const char* traceOpName(TraceOp);
+
+struct TraceStep
+{
+    TraceOp op;
+    uint8_t thread;
+    uint32_t atom;                // ordinal
+    Type type;                    // DEFINE and ADD
+    std::string name;             // nodes
+    std::vector<uint32_t> oset;   // links
+    float strength, conf;         // DEFINE and SET_TV
+    uint32_t key;                 // GET_VALUE and SET_VALUE
+    std::vector<double> values;   // SET_VALUE
+};
+
+struct Trace
+{
+    std::vector<TraceStep> setup;   // the DEFINE steps
+    std::vector<TraceStep> steps;   // everything else, in order
+    uint32_t atoms;                 // number of ordinals
+    int threads;                    // number of recording threads
+    size_t count[NUM_TRACE_OPS];
+};
+
+/// Read a whole trace into memory. False, with a message in error, if
+/// the file is unreadable, not a trace, or truncated.
+bool readTrace(const std::string& path, Trace&, std::string& error);
+
+/**
+ * Writes a trace, as the operations are done. May be called from
+ * several threads; the calls are serialised, and their order is the
+ * order of the trace.
+ */
+class TraceRecorder
+{
+    std::mutex _mtx;
+    std::ofstream _out;
+    std::unordered_map<Handle, uint32_t> _ordinal;
+    size_t _steps;
+    std::string _error;
+
+    uint32_t ordinal(const Handle&, uint8_t thread);
+    void step(TraceOp, uint8_t thread, uint32_t atom);
+    void atomBody(const Handle&);
+
+public:
+    explicit TraceRecorder(const std::string& path);
+
+    bool ok() const { return _error.empty(); }
+    const std::string& error() const { return _error; }
+
+    /// A step that needs only the atom: the getters, and REMOVE.
+    void access(TraceOp, int thread, const Handle&);
+    /// After add_node() or add_link(), with what it returned.
+    void added(int thread, const Handle&);
+    void setTV(int thread, const Handle&, float strength, float conf);
+    void getValue(int thread, const Handle&, const Handle& key);
+    void setValue(int thread, const Handle&, const Handle& key,
+                  const std::vector<double>& values);
+
+    /// Finish the file. Returns the number of steps written.
+    size_t close();
+};
+
+/// Ordinal to atom, while replaying. get() waits for ordinals that
+/// another thread is still to add.
+class ReplayTable
+{
+    enum { EMPTY, SETTING, READY };
+    std::vector<Handle> _atoms;
+    std::unique_ptr<std::atomic<int>[]> _state;
+
+public:
+    explicit ReplayTable(size_t n)
+        : _atoms(n), _state(new std::atomic<int>[n])
+    {
+        for (size_t i = 0; i < n; i++) _state[i] = EMPTY;
+    }
+    // The first add wins; adding the same atom again returns it anyway.
+    void set(uint32_t i, const Handle& h)
+    {
+        int empty = EMPTY;
+        if (not _state[i].compare_exchange_strong(empty, SETTING)) return;
+        _atoms[i] = h;
+        _state[i].store(READY, std::memory_order_release);
+    }
+    const Handle& get(uint32_t i) const
+    {
+        while (READY != _state[i].load(std::memory_order_acquire))
+            std::this_thread::yield();
+        return _atoms[i];
+    }
+};
+
+} // namespace opencog
+
+#endif // _OPENCOG_TRACE_H
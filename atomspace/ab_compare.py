@@ -0,0 +1,216 @@
+#!/usr/bin/env python3
+
+# Compares two AtomSpace builds on the same host, by running
+# atomspace_bm for each method alternately on one and on the other
+# (A B A B ...), optionally pinned to the same cores, and reporting the
+# paired differences of the ops/sec with a 95% confidence interval.
+#
+# The two sides are either two atomspace_bm binaries:
+#
+#   ./ab_compare.py -a old/atomspace_bm -b new/atomspace_bm -m addNode
+#
+# or one binary run against two builds of the AtomSpace libraries,
+# found through LD_LIBRARY_PATH:
+#
+#   ./ab_compare.py --lib-a /opt/old/lib --lib-b /opt/new/lib -m addNode
+#
+# Anything after "--" is passed on to every run of atomspace_bm.
+
+import argparse
+import json
+import math
+import os
+import subprocess
+import sys
+import tempfile
+
+
+# Two-sided 95% quantiles of Student's t, by degrees of freedom.
+T95 = [12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262,
+       2.228, 2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101,
+       2.093, 2.086, 2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052,
+       2.048, 2.045, 2.042]
+
+def t95(df):
+    if df < 1:
+        return float('inf')
+    return T95[df - 1] if df <= len(T95) else 1.960 + 2.4 / df
+
+def median(xs):
+    xs = sorted(xs)
+    n = len(xs)
+    return (xs[n // 2] + xs[(n - 1) // 2]) / 2.0
+
+# "0-3,6" -> {0, 1, 2, 3, 6}
+def parse_cores(spec):
+    cores = set()
+    for part in spec.split(','):
+        lo, _, hi = part.partition('-')
+        cores.update(range(int(lo), int(hi or lo) + 1))
+    return cores
+
+# The most threads that the atomspace_bm arguments ask for, with -T or
+# --build-threads.
+def requested_threads(args):
+    most = 1
+    for i, arg in enumerate(args):
+        value = None
+        for flag in ('-T', '--build-threads'):
+            if arg == flag and i + 1 < len(args):
+                value = args[i + 1]
+            elif arg.startswith(flag) and arg[len(flag):].lstrip('='):
+                value = arg[len(flag):].lstrip('=')
+        if value is not None:
+            try:
+                most = max(most, int(value))
+            except ValueError:
+                pass
+    return most
+
+class Side:
+    def __init__(self, name, binary, libdir):
+        self.name = name
+        self.binary = os.path.abspath(binary)
+        self.env = dict(os.environ)
+        if libdir:
+            # Accept the library itself as well as its directory.
+            if os.path.isfile(libdir):
+                libdir = os.path.dirname(libdir)
+            libdir = os.path.abspath(libdir)
+            old = self.env.get('LD_LIBRARY_PATH')
+            self.env['LD_LIBRARY_PATH'] = libdir + (':' + old if old else '')
+
+    def describe(self):
+        lib = self.env.get('LD_LIBRARY_PATH')
+        return self.binary + (' (LD_LIBRARY_PATH=' + lib + ')' if lib else '')
+
+    # Run one method; returns {"method@threads": ops/sec}.
+    def run(self, method, args, cores):
+        fd, path = tempfile.mkstemp(prefix='ab_compare', suffix='.json')
+        os.close(fd)
+        try:
+            cmd = [self.binary, '-m', method, '-j', path] + args
+            pin = (lambda: os.sched_setaffinity(0, cores)) if cores else None
+            proc = subprocess.run(cmd, env=self.env, preexec_fn=pin,
+                                  stdout=subprocess.PIPE,
+                                  stderr=subprocess.STDOUT,
+                                  universal_newlines=True)
+            if proc.returncode != 0:
+                sys.exit('%s: %s failed with status %d:\n%s' %
+                         (self.name, ' '.join(cmd), proc.returncode,
+                          proc.stdout))
+            results = {}
+            with open(path) as f:
+                for line in f:
+                    rec = json.loads(line)
+                    key = '%s@%d' % (rec['method'], rec['threads'])
+                    results[key] = rec['ops_per_sec']
+            if not results:
+                sys.exit('%s: no results from %s' % (self.name, ' '.join(cmd)))
+            return results
+        finally:
+            os.unlink(path)
+
+# The methods that -l lists, less mix, which needs -W.
+def list_methods(side):
+    out = subprocess.run([side.binary, '-l'], env=side.env,
+                         stdout=subprocess.PIPE, universal_newlines=True).stdout
+    methods = []
+    for line in out.splitlines():
+        if line.startswith('  '):
+            name = line.split()[0]
+            if name != 'mix':
+                methods.append(name)
+    return methods
+
+# The paired differences of b over a, in percent: mean and half-width
+# of the 95% confidence interval.
+def paired(a, b):
+    d = [100.0 * (y - x) / x for x, y in zip(a, b) if x > 0]
+    n = len(d)
+    if n == 0:
+        return float('nan'), float('nan')
+    mean = sum(d) / n
+    if n < 2:
+        return mean, float('inf')
+    var = sum((x - mean) ** 2 for x in d) / (n - 1)
+    return mean, t95(n - 1) * math.sqrt(var / n)
+
+def main():
+    parser = argparse.ArgumentParser(
+        description='Interleaved A/B comparison of two AtomSpace builds.',
+        epilog='Arguments after "--" are passed on to atomspace_bm.')
+    parser.add_argument('-a', default='./atomspace_bm',
+                        help='atomspace_bm of side A (default ./atomspace_bm)')
+    parser.add_argument('-b', help='atomspace_bm of side B (default: as -a)')
+    parser.add_argument('--lib-a', help='directory (or file) of the '
+                        'AtomSpace libraries for side A')
+    parser.add_argument('--lib-b', help='same, for side B')
+    parser.add_argument('-m', '--method', action='append', dest='methods',
+                        help='method to compare; may be repeated '
+                        '(default: all that -l lists, except mix)')
+    parser.add_argument('-n', '--pairs', type=int, default=10,
+                        help='A/B pairs per method (default 10)')
+    parser.add_argument('--cores', default='',
+                        help='cores to pin every run to, e.g. 2 or 2-3; '
+                        'at least as many as -T asks for (default: no '
+                        'pinning)')
+    parser.add_argument('-R', '--seed', type=int, default=42,
+                        help='seed passed to every run (default 42)')
+    parser.add_argument('bm_args', nargs=argparse.REMAINDER)
+    opts = parser.parse_args()
+
+    bm_args = opts.bm_args
+    if bm_args and bm_args[0] == '--':
+        bm_args = bm_args[1:]
+    for bad in ('-m', '-A', '-j', '--json', '-R', '--compare'):
+        if bad in bm_args:
+            sys.exit('ab_compare: %s is set by ab_compare itself' % bad)
+    # The probes would only add a second to every run.
+    bm_args = ['-R', str(opts.seed), '--no-probes'] + bm_args
+
+    a = Side('A', opts.a, opts.lib_a)
+    b = Side('B', opts.b or opts.a, opts.lib_b)
+    if a.describe() == b.describe():
+        sys.exit('ab_compare: A and B are the same build; give -b or '
+                 '--lib-a and --lib-b')
+    cores = parse_cores(opts.cores) if opts.cores else None
+    # Otherwise the threads would measure contention for the cores.
+    threads = requested_threads(bm_args)
+    if cores and len(cores) < threads:
+        sys.exit('ab_compare: %d threads asked for, but only %d cores '
+                 'given with --cores' % (threads, len(cores)))
+    methods = opts.methods or list_methods(a)
+
+    print('A: ' + a.describe())
+    print('B: ' + b.describe())
+    print('Pinned to cores: %s' %
+          (','.join(map(str, sorted(cores))) if cores else 'none'))
+    print('%d pairs per method, in A B A B order\n' % opts.pairs)
+
+    print('%-28s %14s %14s %9s %10s' %
+          ('method@threads', 'A ops/sec', 'B ops/sec', 'B-A %', '95% CI +-'))
+    regressions = 0
+    for method in methods:
+        runs = {}
+        for i in range(opts.pairs):
+            for side in (a, b):
+                for key, ops in side.run(method, bm_args, cores).items():
+                    runs.setdefault(key, ([], []))[side is b].append(ops)
+        for key in sorted(runs):
+            ra, rb = runs[key]
+            mean, half = paired(ra, rb)
+            # Only significant if the interval leaves out zero.
+            mark = ''
+            if mean - half > 0:
+                mark = ' improvement'
+            elif mean + half < 0:
+                mark = ' REGRESSION'
+                regressions += 1
+            print('%-28s %14.0f %14.0f %+8.2f%% %9.2f%%%s' %
+                  (key, median(ra), median(rb), mean, half, mark))
+            sys.stdout.flush()
+    return regressions
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -1,6 +1,8 @@
 
+#include <getopt.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <unistd.h>
 
 #include <cstdlib>
@@ -9,6 +11,61 @@
 
 using namespace std;
 
+// Long options that have no single-letter equivalent.
+enum {
+    OPT_COMPARE = 256,
+    OPT_REPS,
+    OPT_ALPHA,
+    OPT_DURATION,
+    OPT_CI,
+    OPT_MAX_TIME,
+    OPT_SNAPSHOT,
+    OPT_BUILD_THREADS,
+    OPT_BUILD_SCALING,
+    OPT_SIZE_SWEEP,
+    OPT_ARITY,
+    OPT_PROFILE,
+    OPT_PROFILE_HZ,
+    OPT_ISOLATE,
+    OPT_NO_SUBTRACT,
+    OPT_RECORD,
+    OPT_REPLAY,
+    OPT_NO_PROBES,
+    OPT_HUBS,
+    OPT_DUP_INSERT,
+    OPT_RM_TREE,
+    OPT_HIT_RATIO,
+    OPT_SCAN_THREADS,
+};
+
+static const struct option long_options[] = {
+    { "json",    required_argument, NULL, 'j' },
+    { "compare", required_argument, NULL, OPT_COMPARE },
+    { "reps",    required_argument, NULL, OPT_REPS },
+    { "alpha",   required_argument, NULL, OPT_ALPHA },
+    { "duration", required_argument, NULL, OPT_DURATION },
+    { "ci",      required_argument, NULL, OPT_CI },
+    { "max-time", required_argument, NULL, OPT_MAX_TIME },
+    { "snapshot", required_argument, NULL, OPT_SNAPSHOT },
+    { "build-threads", required_argument, NULL, OPT_BUILD_THREADS },
+    { "build-scaling", no_argument, NULL, OPT_BUILD_SCALING },
+    { "size-sweep", required_argument, NULL, OPT_SIZE_SWEEP },
+    { "arity",   required_argument, NULL, OPT_ARITY },
+    { "profile", required_argument, NULL, OPT_PROFILE },
+    { "profile-hz", required_argument, NULL, OPT_PROFILE_HZ },
+    { "isolate", required_argument, NULL, OPT_ISOLATE },
+    { "no-subtract", no_argument, NULL, OPT_NO_SUBTRACT },
+    { "record", required_argument, NULL, OPT_RECORD },
+    { "replay", required_argument, NULL, OPT_REPLAY },
+    { "no-probes", no_argument, NULL, OPT_NO_PROBES },
+    { "hubs",    required_argument, NULL, OPT_HUBS },
+    { "dup-insert", required_argument, NULL, OPT_DUP_INSERT },
+    { "rm-tree", required_argument, NULL, OPT_RM_TREE },
+    { "hit-ratio", required_argument, NULL, OPT_HIT_RATIO },
+    { "scan-threads", required_argument, NULL, OPT_SCAN_THREADS },
+    { NULL, 0, NULL, 0 }
+};
+
 int main(int argc, char** argv)
 {
     const char* benchmark_desc = "Benchmark tool OpenCog AtomSpace\n"
@@ -23,8 +80,40 @@ int main(int argc, char** argv)
      "-c        \tTest the Python API\n"
      "-m <methodname>\tMethod to benchmark\n"
      "-l        \tList valid method names to benchmark\n"
+     "-D <pattern>\tWhich atoms the read methods pick: uniform (default),\n"
+     "          \tzipf:<exponent>, hotspot:<x%ops>:<y%atoms>, sequential\n"
+     "          \tor latest:<exponent>\n"
+     "-W <mix>  \tBenchmark a weighted mix of operations, e.g.\n"
+     "          \tgetTV=60,setTV=20,addLink=15,removeAtom=5\n"
+     "          \t(operations: getType getTV setTV getIncomingSet\n"
+     "          \tgetIncomingSetSize getOutgoingSet getValue setValue addNode\n"
+     "          \taddLink removeAtom)\n"
+     "-O <rates>\tRun the -W mix open-loop at each target rate (ops/sec),\n"
+     "          \tgiven as a list 1000,5000 or a range from:to:factor\n"
+     "--hubs <readers>:<writers>:<hubs>\n"
+     "          \tWriters add links to a few hub atoms while readers get\n"
+     "          \ttheir incoming sets; each a list, e.g. 1,4:1,4:1,64\n"
+     "--dup-insert <pcts>\tInsert -n EvaluationLinks on -T threads, the\n"
+     "          \tgiven percentages of them the same on all threads,\n"
+     "          \te.g. 0,50,100; check the atom counts afterwards\n"
+     "--duration <s>\tSeconds to run each open-loop rate or hub\n"
+     "          \tcontention point (default 1)\n"
+     "--record <file>\tRecord every operation of the -W mix to a trace file\n"
+     "--replay <file>\tReplay a recorded trace as fast as possible, on -T\n"
+     "          \tthreads, instead of running the methods\n"
+     "--scan-threads <int>\tThreads for scanParallel (default: one per core)\n"
+     "--hit-ratio <f>\tFraction of the lookups of getNode, getLink and\n"
+     "          \taddNodeExisting that find an atom (default 0.5)\n"
+     "--rm-tree <depth>:<fanout>\n"
+     "          \tShape of the incoming trees that removeAtomRecursive\n"
+     "          \tremoves (default 4:2)\n"
      "-n <int>  \tHow many times to call the method in the measurement loop\n"
      "          \t(default: 1600000)\n"
+     "-a        \tAuto-calibrate: pick the batch size, skip warmup, and run\n"
+     "          \tuntil the 95% confidence interval is narrow enough\n"
+     "--ci <pct>\tTarget half-width of the interval for -a (default: 1)\n"
+     "--max-time <s>\tGive up on -a after this many seconds (default: 60)\n"
+     "--no-subtract\tDo not subtract the measured timer and loop overhead\n"
      "-r <int>  \tLooping count; how many times a python/scheme operation is looped\n"
      "-u <int>  \tInner looping count\n"
      "          \t(default: 2000)\n"
@@ -34,18 +123,58 @@ int main(int argc, char** argv)
      "          \t(default: time(NULL))\n"
      "-S <int>  \tHow many random atoms to add after each measurement\n"
      "          \t(default: 0)\n"
+     "-T <int>  \tRun each method on 1, 2, 4 ... <int> threads, sharing one\n"
+     "          \tatomspace, and report thread scaling (default: 1)\n"
+     "--isolate <mode>\tRun each repetition in a forked child, and report\n"
+     "          \tits RSS, page faults and context switches; clean (the\n"
+     "          \tchild builds the atomspace) or cow (a copy-on-write copy\n"
+     "          \tof one built by the parent)\n"
      "-- Build test data --\n"
      "-p <float> \tSet the connection probability or coordination number\n"
      "         \t(default: 0.2)\n"
      "         \t(-p impact behaviour of -S too)\n"
      "-s <int> \tSet how many atoms are created (default: 256K)\n"
+     "--size-sweep <from>:<to>[:<factor>]\n"
+     "         \tRun the methods at each size from <from> to <to> atoms,\n"
+     "         \tgrowing by <factor> (default 2); e.g. 2^10:2^26\n"
      "-d <float> \tChance of using default truth value (default: 0.8)\n"
+     "-G <shape> \tShape of the links: uniform (default), ba (preferential\n"
+     "         \tattachment), rmat[:a,b,c] or zipf (word pairs)\n"
+     "--arity <dist>\tLink arities: poisson:<mean> (default 2), fixed:<k>,\n"
+     "         \tuniform:<lo>:<hi> or zipf:<exponent>:<max>\n"
+     "--build-threads <int>\tGenerate the test atomspace on this many threads\n"
+     "--build-scaling\tReport the build rate on 1, 2, 4 ... --build-threads\n"
+     "         \tthreads, and the speedup over one\n"
+     "--snapshot <dir>\tSave the test atomspace in <dir> the first time, and\n"
+     "         \trestore it from there after; keyed by seed and parameters\n"
      "-- Saving data --\n"
      "-k       \tCalculate stats (warning, this will affect rss memory reporting)\n"
-     "-f       \tSave a csv file with records for every repeated event\n"
-     "-i <int> \tSet interval of data to save\n";
+     "-H       \tTime every operation and report latency percentiles\n"
+     "         \t(adds two clock reads to each operation)\n"
+     "-b       \tReport live heap bytes per atom, index entry and type,\n"
+     "         \tand the live heap change of each method\n"
+     "--no-probes\tDo not measure memory latency, bandwidth, malloc and\n"
+     "         \tatomic rates before the benchmarks\n"
+     "-e       \tReport hardware performance counters per operation\n"
+     "         \t(cycles, instructions, cache, TLB and branch misses)\n"
+     "-f       \tSave a binary file with records for every repeated event\n"
+     "--profile <prefix>\tSample the timed regions and write a flamegraph\n"
+     "         \tfolded-stack file <prefix><method>.folded per method\n"
+     "--profile-hz <int>\tSamples per second of CPU time (default: 997)\n"
+     "-i <int> \tSet interval of data to save\n"
+     "-j <file>, --json <file>\n"
+     "         \tAppend one JSON record per method to <file>\n"
+     "--compare <file>\n"
+     "         \tCompare against a baseline written with -j, and flag\n"
+     "         \tsignificant changes; exit status is the number of regressions\n"
+     "--reps <int>\tRun each method this many times\n"
+     "         \t(default: 1, or 5 with --compare)\n"
+     "--alpha <float>\tSignificance level for --compare (default: 0.05)\n";
 
     int c;
+    int numThreads = 1;
+    bool mixWorkload = false;
+    bool mixMethod = false;
 
     if (argc==1) {
         fprintf (stderr, "%s", benchmark_desc);
@@ -56,7 +185,9 @@ int main(int argc, char** argv)
     opterr = 0;
     benchmarker.testKind = opencog::AtomSpaceBenchmark::BENCH_AS;
 
-    while ((c = getopt (argc, argv, "tAXgMCcm:ln:r:u:h:R:S:p:s:d:kfi:")) != -1) {
+    while ((c = getopt_long (argc, argv,
+                "tAXgMCcm:D:G:W:O:ln:ar:u:h:R:S:T:p:s:d:kHebfi:j:",
+                long_options, NULL)) != -1) {
        switch (c)
        {
            case 't':
@@ -94,6 +225,27 @@ int main(int argc, char** argv)
            case 'm':
              benchmarker.buildTestData = true;
              benchmarker.setMethod(optarg);
+             if (0 == strcmp(optarg, "mix")) mixMethod = true;
+             break;
+           case 'D':
+             if (not benchmarker.accessPattern.parse(optarg))
+             {
+                 cerr << "Error: bad access pattern: " << optarg << endl;
+                 exit(1);
+             }
+             break;
+           case 'W':
+             if (not benchmarker.setMix(optarg)) exit(1);
+             benchmarker.buildTestData = true;
+             benchmarker.setMethod("mix");
+             mixWorkload = true;
+             break;
+           case 'O':
+             if (not benchmarker.setRates(optarg)) exit(1);
+             benchmarker.buildTestData = true;
+             break;
+           case OPT_DURATION:
+             benchmarker.openLoopSeconds = atof(optarg);
              break;
            case 'l':
              benchmarker.showMethods();
@@ -119,6 +271,102 @@ int main(int argc, char** argv)
            case 'S':
              benchmarker.sizeIncrease = atoi(optarg);
              break;
+           case 'a':
+             benchmarker.autoCalibrate = true;
+             break;
+           case OPT_CI:
+             benchmarker.autoCI = atof(optarg) / 100.0;
+             break;
+           case OPT_BUILD_THREADS:
+             benchmarker.buildThreads = atoi(optarg);
+             if (benchmarker.buildThreads < 1) benchmarker.buildThreads = 1;
+             break;
+           case 'G':
+             if (not benchmarker.graphShape.parse(optarg))
+             {
+                 cerr << "Error: bad graph shape: " << optarg << endl;
+                 exit(1);
+             }
+             break;
+           case OPT_PROFILE:
+             benchmarker.profilePrefix = optarg;
+             break;
+           case OPT_PROFILE_HZ:
+             benchmarker.profileHz = atoi(optarg);
+             break;
+           case OPT_RECORD:
+             benchmarker.recordFile = optarg;
+             break;
+           case OPT_REPLAY:
+             benchmarker.replayFile = optarg;
+             break;
+           case OPT_NO_SUBTRACT:
+             benchmarker.subtractOverhead = false;
+             break;
+           case OPT_NO_PROBES:
+             benchmarker.runProbes = false;
+             break;
+           case OPT_HUBS:
+             if (not benchmarker.setHubContention(optarg)) exit(1);
+             benchmarker.buildTestData = true;
+             break;
+           case OPT_SCAN_THREADS:
+             benchmarker.scanThreads = atoi(optarg);
+             if (benchmarker.scanThreads < 1) benchmarker.scanThreads = 1;
+             break;
+           case OPT_HIT_RATIO:
+             benchmarker.lookupHitRatio = atof(optarg);
+             if (benchmarker.lookupHitRatio < 0.0
+                 or 1.0 < benchmarker.lookupHitRatio)
+             {
+                 cerr << "Error: the hit ratio must be between 0 and 1\n";
+                 exit(1);
+             }
+             break;
+           case OPT_RM_TREE:
+             if (not benchmarker.setRemoveTree(optarg)) exit(1);
+             break;
+           case OPT_DUP_INSERT:
+             if (not benchmarker.setDupOverlaps(optarg)) exit(1);
+             benchmarker.buildTestData = true;
+             break;
+           case OPT_ISOLATE:
+             if (0 == strcmp(optarg, "clean"))
+                 benchmarker.isolation =
+                     opencog::AtomSpaceBenchmark::ISOLATE_CLEAN;
+             else if (0 == strcmp(optarg, "cow"))
+                 benchmarker.isolation =
+                     opencog::AtomSpaceBenchmark::ISOLATE_COW;
+             else
+             {
+                 cerr << "Error: --isolate is clean or cow" << endl;
+                 exit(1);
+             }
+             break;
+           case OPT_ARITY:
+             if (not benchmarker.arity.parse(optarg))
+             {
+                 cerr << "Error: bad arity distribution: " << optarg << endl;
+                 exit(1);
+             }
+             break;
+           case OPT_SIZE_SWEEP:
+             if (not benchmarker.setSizes(optarg)) exit(1);
+             benchmarker.buildTestData = true;
+             break;
+           case OPT_BUILD_SCALING:
+             benchmarker.buildScaling = true;
+             break;
+           case OPT_SNAPSHOT:
+             benchmarker.snapshotDir = optarg;
+             break;
+           case OPT_MAX_TIME:
+             benchmarker.autoMaxSeconds = atof(optarg);
+             break;
+           case 'T':
+             numThreads = atoi(optarg);
+             if (numThreads < 1) numThreads = 1;
+             break;
            case 'p':
              benchmarker.percentLinks = atof(optarg);
              break;
@@ -131,12 +379,34 @@ int main(int argc, char** argv)
            case 'k':
              benchmarker.doStats = true;
              break;
+           case 'H':
+             benchmarker.perOpLatency = true;
+             break;
+           case 'e':
+             benchmarker.hwCounters = true;
+             break;
+           case 'b':
+             benchmarker.memAccounting = true;
+             break;
            case 'f':
              benchmarker.saveToFile = true;
              break;
            case 'i':
              benchmarker.saveInterval = atoi(optarg);
              break;
+           case 'j':
+             benchmarker.jsonFile = optarg;
+             break;
+           case OPT_COMPARE:
+             benchmarker.compareFile = optarg;
+             break;
+           case OPT_REPS:
+             benchmarker.repetitions = atoi(optarg);
+             if (benchmarker.repetitions < 1) benchmarker.repetitions = 1;
+             break;
+           case OPT_ALPHA:
+             benchmarker.compareAlpha = atof(optarg);
+             break;
            case '?':
              fprintf (stderr, "%s", benchmark_desc);
              return 0;
@@ -166,6 +436,49 @@ int main(int argc, char** argv)
             exit(-1);
         }
     }
+    else if (1 < numThreads)
+    {
+        cerr << "Fatal Error: threads are only supported for the atomspace tests\n";
+        exit(-1);
+    }
+    else if (not benchmarker.hubCounts.empty()
+             or not benchmarker.dupOverlaps.empty())
+    {
+        cerr << "Fatal Error: --hubs and --dup-insert are only supported"
+                " for the atomspace tests\n";
+        exit(-1);
+    }
+    else if (mixWorkload)
+    {
+        cerr << "Fatal Error: operation mixes are only supported for the atomspace tests\n";
+        exit(-1);
+    }
+
+    if (benchmarker.autoCalibrate and 1 < numThreads)
+    {
+        cerr << "Fatal Error: -a only works single-threaded\n";
+        exit(-1);
+    }
+
+    if (mixMethod and not mixWorkload)
+    {
+        cerr << "Fatal Error: -m mix needs an operation mix, given with -W\n";
+        exit(-1);
+    }
+
+    if (not benchmarker.openLoopRates.empty() and not mixWorkload)
+    {
+        cerr << "Fatal Error: -O needs an operation mix, given with -W\n";
+        exit(-1);
+    }
+
+    if (not benchmarker.recordFile.empty()
+        and (not mixWorkload or not benchmarker.openLoopRates.empty()))
+    {
+        cerr << "Fatal Error: --record records the operations of a -W mix,"
+                " without -O\n";
+        exit(-1);
+    }
 
 #ifdef HAVE_CYTHON
     if ((true == benchmarker.compile)
@@ -187,6 +500,5 @@ int main(int argc, char** argv)
     }
 #endif // HAVE_GUILE
 
-    benchmarker.startBenchmark();
-    return 0;
+    return benchmarker.startBenchmark(numThreads);
 }
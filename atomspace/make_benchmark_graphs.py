@@ -1,11 +1,12 @@
 #!/usr/bin/env python
 
 # Requires matplotlib for graphing
-# reads *_benchmark.csv files as output by atomspace_bm and turns them into
-# graphs.
+# reads *_benchmark.bin files as output by atomspace_bm -f (and the
+# *_benchmark.csv files of older versions) and turns them into graphs.
 
 
 import csv
+import struct
 import numpy as np
 import matplotlib.colors as colors
 #import matplotlib.finance as finance
@@ -38,15 +39,38 @@ def moving_average(x, n, type='simple'):
     a[:n] = a[n]
     return a
 
+def read_csv(fn):
+    rows = []
+    for row in csv.reader(open(fn,'r'),delimiter=","):
+        rows.append((int(row[0]), int(row[1]), int(row[2]), float(row[3])))
+    return rows
+
+# The header is "ASBMSAMP", the version, the size of a record and the
+# clock ticks per second; then (atomspace size, ticks, heap change in KB)
+# per record. See SampleRing.h.
+def read_samples(fn):
+    data = open(fn,'rb').read()
+    magic, version, record_size, ticks_per_sec = struct.unpack_from("<8sIId", data)
+    if magic != b"ASBMSAMP" or version != 1:
+        raise ValueError(fn + " is not an atomspace_bm sample file")
+    rows = []
+    for offset in range(24, len(data) - record_size + 1, record_size):
+        size, ticks, memory = struct.unpack_from("<Qqq", data, offset)
+        rows.append((size, ticks, memory, ticks / ticks_per_sec))
+    return rows
+
 def graph_file(fn,delta_rss=True):
-    print "Graphing " + fn
-    records = csv.reader(open(fn,'rb'),delimiter=",")
+    print("Graphing " + fn)
+    if fn.endswith(".bin"):
+        records = read_samples(fn)
+    else:
+        records = read_csv(fn)
     sizes=[]; times=[]; times_seconds=[]; memories=[]
     for row in records:
-        sizes.append(int(row[0]))
-        times.append(int(row[1]))
-        memories.append(int(row[2]))
-        times_seconds.append(float(row[3]))
+        sizes.append(row[0])
+        times.append(row[1])
+        memories.append(row[2])
+        times_seconds.append(row[3])
 
     left, width = 0.1, 0.8
     rect1 = [left, 0.5, width, 0.4]  #left, bottom, width, height
@@ -60,7 +84,7 @@ def graph_file(fn,delta_rss=True):
 
     ax1.plot(sizes,times_seconds,color='black')
     if len(times_seconds) > 1000:
-        ax1.plot(sizes,moving_average(times_seconds,len(times_second) / 100),color='blue')
+        ax1.plot(sizes,moving_average(times_seconds,len(times_seconds) // 100),color='blue')
     if delta_rss:
         oldmemories = list(memories)
         for i in range(1,len(memories)): memories[i] = oldmemories[i] - oldmemories[i-1]
@@ -102,7 +126,7 @@ def graph_file(fn,delta_rss=True):
 
     fig.savefig(fn+".png",format="png")
 
-files_to_graph = glob.glob("*_benchmark.csv")
+files_to_graph = glob.glob("*_benchmark.bin") + glob.glob("*_benchmark.csv")
 
 for fn in files_to_graph:
     graph_file(fn);
@@ -23,10 +23,13 @@
  */
 
 #include <benchmark/benchmark.h>
+#include <cstring>
 #include <sstream>
 
 #include <opencog/util/Logger.h>
 
+#include "SampleProfiler.h"
+
 using namespace opencog;
 
 std::string get_unique_name(const std::string& prefix, size_t& seed)
@@ -36,9 +39,71 @@ std::string get_unique_name(const std::string& prefix, size_t& seed)
 	return oss.str();
 }
 
+// Run::benchmark_name became a method in Google Benchmark 1.5
+template<typename Run>
+static auto run_name(const Run& run, int) -> decltype(run.benchmark_name())
+{
+	return run.benchmark_name();
+}
+
+template<typename Run>
+static std::string run_name(const Run& run, long)
+{
+	return run.benchmark_name;
+}
+
+// Google Benchmark has no hook around the timing loop, so the sampler
+// runs for the whole of each benchmark, setup included, and the profile
+// is cut whenever a benchmark reports.
+class ProfilingReporter : public benchmark::ConsoleReporter
+{
+public:
+	explicit ProfilingReporter(const std::string& prefix)
+		: profiler(prefix)
+	{
+		profiler.sampleAllThreads(true);
+		profiler.start();
+	}
+
+	void ReportRuns(const std::vector<Run>& runs) override
+	{
+		if (not runs.empty())
+		{
+			std::string name = run_name(runs[0], 0);
+			for (char& c : name)
+				if ('/' == c) c = '_';
+			profiler.stop(name);
+		}
+		ConsoleReporter::ReportRuns(runs);
+		profiler.start();
+	}
+
+private:
+	SampleProfiler profiler;
+};
+
 int main(int argc, char** argv)
 {
+	// --profile=<prefix> writes <prefix><benchmark>.folded for each
+	// benchmark; take it out before Google Benchmark sees it.
+	std::string profile_prefix;
+	int j = 1;
+	for (int i = 1; i < argc; i++)
+	{
+		if (0 == strncmp(argv[i], "--profile=", 10))
+			profile_prefix = argv[i] + 10;
+		else
+			argv[j++] = argv[i];
+	}
+	argc = j;
+
 	logger().set_level(Logger::FINE);
 	benchmark::Initialize(&argc, argv);
-	benchmark::RunSpecifiedBenchmarks();
+	if (profile_prefix.empty())
+	{
+		benchmark::RunSpecifiedBenchmarks();
+		return 0;
+	}
+	ProfilingReporter reporter(profile_prefix);
+	benchmark::RunSpecifiedBenchmarks(&reporter);
 }
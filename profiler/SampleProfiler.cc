@@ -0,0 +1,193 @@
+/** SampleProfiler.cc */
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <unordered_map>
+#include <vector>
+
+#include <cxxabi.h>
+#include <dlfcn.h>
+#include <execinfo.h>
+#include <signal.h>
+#include <sys/time.h>
+
+#include "SampleProfiler.h"
+
+namespace opencog {
+
+// About half a minute of CPU time at the default rate; later samples
+// are counted as dropped.
+static const size_t MAX_SAMPLES = 1 << 15;
+static const int MAX_DEPTH = 64;
+// onSigprof() and the signal return trampoline; backtrace() does not
+// record its own frame. The next frame is the interrupted pc rather
+// than a return address, so stop() takes 1 off every address but the
+// one at SKIP_FRAMES, and relies on this count being exact.
+static const int SKIP_FRAMES = 2;
+
+struct Sample
+{
+    std::atomic<bool> ready;
+    int depth;
+    void* pc[MAX_DEPTH];
+};
+
+static Sample* samples = NULL;
+static std::atomic<size_t> nextSample(0);
+static std::atomic<size_t> dropped(0);
+static std::atomic<bool> armed(false);
+static std::atomic<bool> allThreads(false);
+static __thread bool inRegion = false;
+
+static void onSigprof(int, siginfo_t*, void*)
+{
+    if (not armed or not (inRegion or allThreads)) return;
+    int savedErrno = errno;
+    size_t i = nextSample.fetch_add(1, std::memory_order_relaxed);
+    if (i < MAX_SAMPLES)
+    {
+        samples[i].depth = backtrace(samples[i].pc, MAX_DEPTH);
+        samples[i].ready.store(true, std::memory_order_release);
+    }
+    else dropped++;
+    errno = savedErrno;
+}
+
+SampleProfiler::SampleProfiler(const std::string& prefix, int hz)
+    : _prefix(prefix), _hz(hz < 1 ? 1 : hz)
+{
+    if (NULL == samples) samples = new Sample[MAX_SAMPLES];
+
+    // The first call to backtrace() loads libgcc, which must not
+    // happen inside the signal handler.
+    void* warmup[2];
+    backtrace(warmup, 2);
+
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_sigaction = onSigprof;
+    sa.sa_flags = SA_SIGINFO | SA_RESTART;
+    sigemptyset(&sa.sa_mask);
+    sigaction(SIGPROF, &sa, NULL);
+}
+
+SampleProfiler::~SampleProfiler()
+{
+    struct itimerval off;
+    memset(&off, 0, sizeof(off));
+    setitimer(ITIMER_PROF, &off, NULL);
+    armed = false;
+    signal(SIGPROF, SIG_IGN);
+}
+
+void SampleProfiler::start()
+{
+    armed = false;
+    size_t n = std::min((size_t) nextSample, MAX_SAMPLES);
+    for (size_t i = 0; i < n; i++) samples[i].ready = false;
+    nextSample = 0;
+    dropped = 0;
+    armed = true;
+
+    struct itimerval it;
+    it.it_interval.tv_sec = 0;
+    it.it_interval.tv_usec = 1000000 / _hz;
+    if (0 == it.it_interval.tv_usec) it.it_interval.tv_usec = 1;
+    it.it_value = it.it_interval;
+    setitimer(ITIMER_PROF, &it, NULL);
+}
+
+void SampleProfiler::resume() { inRegion = true; }
+void SampleProfiler::pause() { inRegion = false; }
+void SampleProfiler::sampleAllThreads(bool all) { allThreads = all; }
+
+// Function name at pc, demangled, or [module] if it has none.
+static std::string symbolize(void* pc)
+{
+    Dl_info info;
+    if (0 == dladdr(pc, &info) or NULL == info.dli_fname)
+    {
+        char buf[32];
+        snprintf(buf, sizeof(buf), "%p", pc);
+        return buf;
+    }
+    std::string name;
+    if (info.dli_sname)
+    {
+        int status = 0;
+        char* demangled = abi::__cxa_demangle(info.dli_sname, NULL, NULL,
+                                              &status);
+        name = (0 == status and demangled) ? demangled : info.dli_sname;
+        free(demangled);
+    }
+    else
+    {
+        // No exported symbol; lump it in with the rest of its module.
+        const char* base = strrchr(info.dli_fname, '/');
+        name = "[" + std::string(base ? base + 1 : info.dli_fname) + "]";
+    }
+    // The folded format uses ';' between frames.
+    for (char& c : name) if (';' == c) c = ':';
+    return name;
+}
+
+size_t SampleProfiler::stop(const std::string& name)
+{
+    struct itimerval off;
+    memset(&off, 0, sizeof(off));
+    setitimer(ITIMER_PROF, &off, NULL);
+    armed = false;
+
+    std::unordered_map<void*, std::string> symbols;
+    std::map<std::string, size_t> folded;
+    size_t n = std::min((size_t) nextSample, MAX_SAMPLES);
+    size_t total = 0;
+    for (size_t i = 0; i < n; i++)
+    {
+        if (not samples[i].ready.load(std::memory_order_acquire)) continue;
+        std::string stack;
+        for (int d = samples[i].depth - 1; d >= SKIP_FRAMES; d--)
+        {
+            // Return addresses point past the call; look up the call.
+            void* pc = samples[i].pc[d];
+            if (d > SKIP_FRAMES) pc = (char*) pc - 1;
+            auto it = symbols.find(pc);
+            if (it == symbols.end())
+                it = symbols.emplace(pc, symbolize(pc)).first;
+            if (not stack.empty()) stack += ';';
+            stack += it->second;
+        }
+        if (stack.empty()) continue;
+        folded[stack]++;
+        total++;
+    }
+
+    std::string file = _prefix;
+    for (char c : name)
+        file += (isalnum(c) or '-' == c or '.' == c) ? c : '_';
+    file += ".folded";
+    std::ofstream out(file);
+    if (not out)
+    {
+        std::cerr << "Error: cannot write profile " << file << std::endl;
+        return 0;
+    }
+    for (const auto& kv : folded)
+        out << kv.first << " " << kv.second << "\n";
+
+    std::cout << "Profile: " << total << " samples in " << file;
+    if (dropped)
+        std::cout << " (" << dropped << " more dropped; the buffer is full)";
+    std::cout << std::endl;
+    return total;
+}
+
+} // namespace opencog
@@ -0,0 +1,51 @@
+#ifndef _OPENCOG_SAMPLE_PROFILER_H
+#define _OPENCOG_SAMPLE_PROFILER_H
+
+#include <cstddef>
+#include <string>
+
+namespace opencog
+{
+
+/**
+ * A sampling profiler that runs inside the benchmark, needing neither
+ * root nor perf. A CPU-time interval timer (ITIMER_PROF) sends SIGPROF
+ * at the given rate; the handler unwinds the stack of the interrupted
+ * thread with backtrace(3), into a preallocated buffer. Only threads
+ * between resume() and pause() are sampled, so that setup code stays
+ * out of the profile, unless sampleAllThreads() is set.
+ *
+ * stop() writes the samples as folded stacks, one line per distinct
+ * stack, "outermost;...;innermost count", to <prefix><name>.folded.
+ * That is the input format of flamegraph.pl, speedscope and inferno.
+ *
+ * Function names come from dladdr(3), so the executable must be linked
+ * with -rdynamic for its own functions to show up by name. There can
+ * only be one profiler at a time.
+ */
+class SampleProfiler
+{
+public:
+    explicit SampleProfiler(const std::string& prefix, int hz = 997);
+    ~SampleProfiler();
+
+    /// Throw away old samples and start the timer.
+    void start();
+    /// Stop the timer and write <prefix><name>.folded. Returns the
+    /// number of samples written.
+    size_t stop(const std::string& name);
+
+    /// Start and stop sampling the calling thread.
+    static void resume();
+    static void pause();
+
+    void sampleAllThreads(bool all);
+
+private:
+    std::string _prefix;
+    int _hz;
+};
+
+} // namespace opencog
+
+#endif // _OPENCOG_SAMPLE_PROFILER_H
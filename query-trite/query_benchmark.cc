@@ -22,6 +22,7 @@
  * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
  */
 
+#include <memory>
 #include <string>
 #include <vector>
 #include <iostream>
@@ -30,6 +31,8 @@
 #include <opencog/guile/SchemeEval.h>
 #include <opencog/atomspace/AtomSpace.h>
 
+#include "SampleProfiler.h"
+
 #define DEFAULT_CONFIG_FILE_NAME "query_benchmark.conf"
 #define BENCHMARKS_TO_RUN_PROPERTY "benchmarks_to_run"
 
@@ -41,6 +44,7 @@ std::string working_dir = ".";
 std::string config_file_name = DEFAULT_CONFIG_FILE_NAME;
 std::string benchmarks_to_run = "";
 int omp_number_of_threads = 1;
+std::string profile_prefix = "";
 
 Config configuration;
 
@@ -101,11 +105,21 @@ void run_benchmark(const std::string& id)
 
     {
         ValuePtr result;
+        std::unique_ptr<SampleProfiler> profiler;
+        if (!profile_prefix.empty()) {
+            profiler.reset(new SampleProfiler(profile_prefix));
+            profiler->start();
+            SampleProfiler::resume();
+        }
         TimePoint start = std::chrono::high_resolution_clock::now();
         for (int iteration = 0; iteration < iterations_count; iteration++) {
             result = query->execute(&atomspace);
         }
         TimePoint end = std::chrono::high_resolution_clock::now();
+        if (profiler) {
+            SampleProfiler::pause();
+            profiler->stop(id);
+        }
         double duration_ms = duration_in_millis(start, end);
         std::cout << "query executed " << iterations_count << " time(s) in: "
                 <<  duration_ms << " ms" << std::endl;
@@ -122,7 +136,7 @@ int parse_command_line(int argc, char** argv)
 {
     const std::string description =
         "Query benchmark tool\n"
-        "Usage: query_benchmark [-d <working_dir>] [-c <config>] [-t <benchmark_id>] [p <number>]\n"
+        "Usage: query_benchmark [-d <working_dir>] [-c <config>] [-t <benchmark_id>] [p <number>] [-P <prefix>]\n"
         "Options:\n"
         "  -d <working_dir> - working dir, default: current dir\n"
         "\n"
@@ -139,11 +153,13 @@ int parse_command_line(int argc, char** argv)
         "\n"
         "  -t <benchmark_id>,... - comma separated list of benchmarks to run,\n"
         "                          default: run all benchmarks from config\n"
-        "  -p <number> - set number of OpenMP threads when running test, default: 1\n";
+        "  -p <number> - set number of OpenMP threads when running test, default: 1\n"
+        "  -P <prefix> - sample the query loop and write flame graph folded stacks\n"
+        "                to <prefix><benchmark_id>.folded\n";
     int c;
 
     opterr = 0;
-    while ((c = getopt(argc, argv, "d:t:c:p:")) != -1) {
+    while ((c = getopt(argc, argv, "d:t:c:p:P:")) != -1) {
         switch (c)
         {
         case 'd':
@@ -158,6 +174,9 @@ int parse_command_line(int argc, char** argv)
         case 'p':
             omp_number_of_threads = atoi(optarg);
             break;
+        case 'P':
+            profile_prefix = optarg;
+            break;
         case '?':
             std::cerr << description;
             return -1;